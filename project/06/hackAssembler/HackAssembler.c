@@ -8,58 +8,298 @@ void assembler_print_help();
 
 int main(int argc, char **argv) {
     // 1) Open the file or throw error
-    char filename[50];
-    if (argc > 2) {
-        printf("Too many arguments supplied.\n");
+    AssemblerOptions options;
+    if (!assembler_parse_arguments(argc, argv, &options)) {
         assembler_print_help();
         return 1;
-    } else if (argc <= 1) {
-        printf("One argument expected.\n");
-        assembler_print_help();
-        return 1;
-    } else {
-        strcpy(filename, argv[1]);
     }
+    const char *filename = options.filename;
 
     // Allocate filestream and parse it
     FILE *filestream = NULL;
-    HackInstructions list = NULL;
+    HackInstructions list;
+    HI_init(&list);
     HackSymbolTable table;
     ST_initialise(&table);
-    filestream = fopen(filename, "r");
+    // "-" reads the source from standard input, so that the assembler can
+    // sit at the end of a pipe
+    bool fromStdin = strcmp(filename, "-") == 0;
+    filestream = fromStdin ? stdin : fopen(filename, "r");
     if (filestream == NULL) {
         fprintf(stderr, "Could not open %s\n", filename);
         assembler_print_help();
         return 1;
     }
 
-    parser_labels_pass(filestream, &table);
-    /* ST_print_table(&table); */
+    // The whole file is mapped in memory and read in place
+    // A pipe cannot be mapped, it is then read once into a single buffer
+    HackSource source;
+    if (!HS_load(&source, filestream)) {
+        fprintf(stderr, "Could not read %s\n", filename);
+        if (!fromStdin) {
+            fclose(filestream);
+        }
+        return 1;
+    }
+    if (!fromStdin) {
+        fclose(filestream);
+    }
+    if (options.format == ASM_FORMAT_OBJECT) {
+        bool written = assembler_write_object(&options, &source);
+        HS_release(&source);
+        HI_delete_all_instructions(&list);
+        ST_delete_all_entries(&table);
+        return written ? 0 : 1;
+    }
 
-    // At this point, Symbol table is filled, and labels will be
-    // ignored.
-    // Variables can stay and will be replaced
-    // Returns the count of read instructions
-    filestream = freopen(NULL, "r", filestream);
-    uint32_t instructionCount =
-        symbolless_stream_to_machine_code(filestream, &list, &table);
-    fclose(filestream);
+    // Labels and variables are resolved while reading the source, so
+    // the file is read only once (twice, by chunks, for large sources)
+    HackDiagnostics diag;
+    HD_init(&diag, true);
+    // The listing follows the encoded lines, so with -O it is filled by the
+    // optimizer, otherwise the source is read once more
+    HackListing listing;
+    HLS_init(&listing);
+    bool wantsListing = options.mapPath != NULL || options.listingPath != NULL;
+    uint32_t instructionCount = 0;
+    if (options.optimize) {
+        if (options.cachePath != NULL) {
+            fprintf(stderr, "--cache is ignored with -O\n");
+        }
+        HackRules rules;
+        HR_init(&rules);
+        if (options.rulesPath != NULL && !HR_load(&rules, options.rulesPath)) {
+            HR_delete_all_rules(&rules);
+            HS_release(&source);
+            return 1;
+        }
+        HO_stats stats;
+        instructionCount = source_to_machine_code_optimized(
+            source.data, source.length, &list, &table, &rules,
+            options.outlineLength, &diag, &stats,
+            wantsListing ? &listing : NULL);
+        if (stats.absoluteJumpLine != 0) {
+            fprintf(stderr,
+                    "Not optimized : jump to a numeric address on line %u\n",
+                    stats.absoluteJumpLine);
+        }
+        fprintf(stderr,
+                "Optimizer threaded %u jumps, removed %u unreachable "
+                "words, %u words of jumps to the next instruction, %u "
+                "labels, %u loads, %u operations and %u increment pairs, "
+                "rewrote %u windows\n",
+                stats.threadedJumps, stats.unreachableWords,
+                stats.jumpToNextWords, stats.unusedLabels, stats.removedLoads,
+                stats.removedOperations, stats.cancelledPairs,
+                stats.rewrittenWindows);
+        if (options.outlineLength > 0 && stats.outlineSkipped) {
+            fprintf(stderr, "Not outlined : the program does not end with an "
+                            "unconditional jump\n");
+        } else if (options.outlineLength > 0) {
+            fprintf(stderr,
+                    "Outlined %u sequences in %u calls, saving %u words\n",
+                    stats.outlinedSequences, stats.outlinedCalls,
+                    stats.outlinedWords);
+        }
+        HR_delete_all_rules(&rules);
+    } else if (options.cachePath != NULL) {
+        HSC_stats stats;
+        instructionCount = source_to_machine_code_cached(
+            source.data, source.length, &list, &table, options.cachePath,
+            &stats, &diag);
+        fprintf(stderr, "Reused %u/%u segments from %s\n", stats.reusedCount,
+                stats.segmentCount, options.cachePath);
+    } else {
+        instructionCount = source_to_machine_code_parallel(
+            source.data, source.length, &list, &table, options.jobs, &diag);
+    }
     fprintf(stderr, "Parsing finished, %d instructions total\n",
             instructionCount);
-    // HI_print_all prints to stdout
-    HI_print_all_instructions(&list);
+    if (wantsListing && !options.optimize) {
+        HLS_read(&listing, source.data, source.length);
+    }
+    // The machine code is written to stdout
+    bool written = true;
+    if (options.format == ASM_FORMAT_BIN) {
+        written = HI_write_binary(&list, stdout, options.bigEndian);
+    } else if (list.size == 0) {
+        fprintf(stderr, "The list is empty now ??\n");
+    } else {
+        written = HI_write_text(&list, stdout);
+    }
+    if (!written) {
+        fprintf(stderr, "Could not write the machine code\n");
+    }
+    if (options.mapPath != NULL &&
+        !assembler_write_map(options.mapPath, &listing, &table)) {
+        written = false;
+    }
+    if (options.listingPath != NULL &&
+        !assembler_write_listing(options.listingPath, &listing, &list)) {
+        written = false;
+    }
 
     // Cleanup
+    // The fixups pointed into the source, so it is released only now
+    HS_release(&source);
+    HLS_delete_listing(&listing);
     HI_delete_all_instructions(&list);
     ST_delete_all_entries(&table);
-    return 0;
+    // The words of the bad lines are still written, but scripts must see
+    // that the assembly failed
+    return written && diag.errorCount == 0 ? 0 : 1;
+}
+
+bool assembler_parse_arguments(int argc, char **argv,
+                               AssemblerOptions *p_options) {
+    p_options->filename = NULL;
+    p_options->format = ASM_FORMAT_HACK;
+    p_options->bigEndian = false;
+    p_options->jobs = HP_available_jobs();
+    p_options->cachePath = NULL;
+    p_options->optimize = false;
+    p_options->rulesPath = NULL;
+    p_options->outlineLength = 0;
+    p_options->mapPath = NULL;
+    p_options->listingPath = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--format=hack") == 0) {
+            p_options->format = ASM_FORMAT_HACK;
+        } else if (strcmp(argv[i], "--format=bin") == 0) {
+            p_options->format = ASM_FORMAT_BIN;
+        } else if (strcmp(argv[i], "--format=obj") == 0) {
+            p_options->format = ASM_FORMAT_OBJECT;
+        } else if (strcmp(argv[i], "--endian=little") == 0) {
+            p_options->bigEndian = false;
+        } else if (strcmp(argv[i], "--endian=big") == 0) {
+            p_options->bigEndian = true;
+        } else if (strncmp(argv[i], "--jobs=", 7) == 0) {
+            p_options->jobs = atoi(argv[i] + 7);
+            if (p_options->jobs <= 0) {
+                p_options->jobs = HP_available_jobs();
+            }
+        } else if (strncmp(argv[i], "--cache=", 8) == 0 &&
+                   argv[i][8] != '\0') {
+            p_options->cachePath = argv[i] + 8;
+        } else if (strcmp(argv[i], "-O") == 0) {
+            p_options->optimize = true;
+        } else if (strncmp(argv[i], "--rules=", 8) == 0 &&
+                   argv[i][8] != '\0') {
+            // Rules are applied by the optimizer
+            p_options->rulesPath = argv[i] + 8;
+            p_options->optimize = true;
+        } else if (strncmp(argv[i], "--outline=", 10) == 0) {
+            // Outlining runs after the optimizer
+            int length = atoi(argv[i] + 10);
+            if (length < HOL_MIN_LENGTH) {
+                printf("--outline expects a length of at least %d.\n",
+                       HOL_MIN_LENGTH);
+                return false;
+            }
+            p_options->outlineLength = length;
+            p_options->optimize = true;
+        } else if (strncmp(argv[i], "--map=", 6) == 0 && argv[i][6] != '\0') {
+            p_options->mapPath = argv[i] + 6;
+        } else if (strncmp(argv[i], "--lst=", 6) == 0 && argv[i][6] != '\0') {
+            p_options->listingPath = argv[i] + 6;
+        } else if (strncmp(argv[i], "--", 2) == 0) {
+            printf("Unknown option %s.\n", argv[i]);
+            return false;
+        } else if (p_options->filename != NULL) {
+            printf("Too many arguments supplied.\n");
+            return false;
+        } else {
+            p_options->filename = argv[i];
+        }
+    }
+    if (p_options->filename == NULL) {
+        printf("One argument expected.\n");
+        return false;
+    }
+    return true;
 }
 
 void assembler_print_help() {
     printf("HackAssembler : Assembler for the Hack machine language\n");
-    printf("Usage : HackAssembler [filename]\n");
-    printf("Prints the assembly code on standard output,\n");
-    printf("prints the symbol table just before on standard ERROR output\n");
-    printf("Also prints other status messages on standard ERROR, before");
-    printf(" the actual machine code\n");
+    printf("Usage : HackAssembler [options] [filename]\n");
+    printf("Reads the source from standard input if filename is -\n");
+    printf("Prints the machine code on standard output,\n");
+    printf("prints status messages on standard ERROR\n");
+    printf("Options :\n");
+    printf("  --format=hack    .hack text output, one line per word (default)\n");
+    printf("  --format=bin     raw ROM image of 16-bit words\n");
+    printf("  --format=obj     relocatable object, linked by HackLinker\n");
+    printf("  --endian=little  byte order of the ROM image (default)\n");
+    printf("  --endian=big\n");
+    printf("  --jobs=N         threads used on large sources (default : one\n");
+    printf("                   per processor, 1 is sequential)\n");
+    printf("  -O               remove redundant instructions (jumps must\n");
+    printf("                   target labels)\n");
+    printf("  --rules=FILE     with -O, also rewrite the windows of C\n");
+    printf("                   instructions found in FILE (implies -O)\n");
+    printf("  --outline=N      with -O, also move the sequences of at least N\n");
+    printf("                   instructions found several times to\n");
+    printf("                   subroutines (N >= 5, implies -O)\n");
+    printf("  --cache=FILE     reassemble incrementally, reusing the unchanged\n");
+    printf("                   functions found in FILE, then updating it\n");
+    printf("  --map=FILE       writes the labels and variables with their\n");
+    printf("                   address, sorted by address\n");
+    printf("  --lst=FILE       writes the address, bits and source line of\n");
+    printf("                   every word\n");
+}
+
+bool assembler_write_object(const AssemblerOptions *p_options,
+                            const HackSource *p_source) {
+    // The other objects are not known here : removing unreachable code or
+    // allocating variables would be wrong
+    if (p_options->optimize || p_options->cachePath != NULL ||
+        p_options->mapPath != NULL || p_options->listingPath != NULL) {
+        fprintf(stderr,
+                "-O, --rules, --outline, --cache, --map and --lst are ignored "
+                "with --format=obj\n");
+    }
+    HackDiagnostics diag;
+    HD_init(&diag, true);
+    HackObject object;
+    HOB_init(&object);
+    uint32_t instructionCount =
+        source_to_object(p_source->data, p_source->length, &object, &diag);
+    fprintf(stderr, "Parsing finished, %d instructions total\n",
+            instructionCount);
+    bool written = HOB_write(&object, stdout);
+    if (!written) {
+        fprintf(stderr, "Could not write the object\n");
+    }
+    HOB_delete_object(&object);
+    return written && diag.errorCount == 0;
+}
+
+bool assembler_write_map(const char *path, HackListing *p_listing,
+                         HackSymbolTable *p_table) {
+    FILE *stream = fopen(path, "w");
+    if (stream == NULL) {
+        fprintf(stderr, "Could not open %s\n", path);
+        return false;
+    }
+    bool written = HLS_write_map(p_listing, p_table, stream);
+    written = fclose(stream) == 0 && written;
+    if (!written) {
+        fprintf(stderr, "Could not write %s\n", path);
+    }
+    return written;
+}
+
+bool assembler_write_listing(const char *path, const HackListing *p_listing,
+                             const HackInstructions *p_list) {
+    FILE *stream = fopen(path, "w");
+    if (stream == NULL) {
+        fprintf(stderr, "Could not open %s\n", path);
+        return false;
+    }
+    bool written = HLS_write_listing(p_listing, p_list, stream);
+    written = fclose(stream) == 0 && written;
+    if (!written) {
+        fprintf(stderr, "Could not write %s\n", path);
+    }
+    return written;
 }
@@ -8,9 +8,61 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "HackFixupList.h"
 #include "HackInstruction.h"
 #include "HackInstructionList.h"
+#include "HackLexer.h"
+#include "HackListing.h"
+#include "HackObject.h"
+#include "HackOptimizer.h"
+#include "HackOutliner.h"
+#include "HackParallel.h"
 #include "HackParser.h"
+#include "HackRules.h"
+#include "HackSegmentCache.h"
 #include "HackSymbolTable.h"
 
+typedef enum AssemblerFormat {
+    // .hack text, one line of 16 '0'/'1' per instruction
+    ASM_FORMAT_HACK,
+    // Raw ROM image of 16-bit words
+    ASM_FORMAT_BIN,
+    // Relocatable object, linked by HackLinker
+    ASM_FORMAT_OBJECT
+} AssemblerFormat;
+
+typedef struct AssemblerOptions {
+    const char* filename;
+    AssemblerFormat format;
+    bool bigEndian;
+    // Number of threads used to assemble large sources
+    int jobs;
+    // Segment cache file for incremental assembly, or NULL
+    const char* cachePath;
+    // Run the peephole optimizer before encoding
+    bool optimize;
+    // Rewrite rules applied after the peephole pass, or NULL
+    const char* rulesPath;
+    // Shortest sequence outlined after the rules, 0 to outline nothing
+    uint32_t outlineLength;
+    // Symbol map and listing files, or NULL
+    const char* mapPath;
+    const char* listingPath;
+} AssemblerOptions;
+
+// Fills p_options from the command line
+// Returns false if the command line is invalid
+bool assembler_parse_arguments(int argc, char** argv,
+                               AssemblerOptions* p_options);
+// Assembles the source as a relocatable object, written on stdout
+// Returns false if the source has errors or the object could not be written
+bool assembler_write_object(const AssemblerOptions* p_options,
+                            const HackSource* p_source);
+// Writes the symbol map or the listing in the file at path
+// Returns false if the file could not be written
+bool assembler_write_map(const char* path, HackListing* p_listing,
+                         HackSymbolTable* p_table);
+bool assembler_write_listing(const char* path, const HackListing* p_listing,
+                             const HackInstructions* p_list);
+
 #endif  // HACKASSEMBLER_H_
@@ -0,0 +1,301 @@
+// Benchmark of the assembler on synthetic programs
+// Usage : HackBenchmark [options]
+// A program of --lines lines is generated in memory from a seed, with
+// labels, references to labels and variables, C instructions, comments and
+// blank or indented lines in the given proportions. Each phase of the
+// assembler is then timed on it :
+// - lex : HL_next_line over the whole source,
+// - encode : the single pass of source_to_machine_code, which also adds
+//   the labels to the symbol table and records the forward references,
+// - resolve : parser_resolve_fixups, the labels defined after their use
+//   and the variables,
+// - output : HI_write_text to /dev/null,
+// - parallel : source_to_machine_code_parallel with every processor.
+// The throughput is given in source lines per second, and the peak RSS of
+// the process, which holds the generated source, at the end.
+// With --emit, the program is written on stdout instead, to be given to
+// HackAssembler or to other assemblers.
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif  // _POSIX_C_SOURCE
+
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "HackDiagnostics.h"
+#include "HackInstructionList.h"
+#include "HackLexer.h"
+#include "HackParallel.h"
+#include "HackParser.h"
+#include "HackSymbolTable.h"
+
+#define HBM_INITIAL_CAPACITY (1 << 20)
+
+static const char* const HBM_COMPS[] = {
+    "D=M",   "M=D",   "A=M",    "D=A",   "AM=M-1", "M=M+1",
+    "D=D+M", "D=D-A", "M=M-D",  "D=!D",  "MD=M+1", "AD=D|M",
+    "0;JMP", "D;JEQ", "D;JGT",  "D;JLT", "D;JNE",  "M=-1"};
+#define HBM_COMP_COUNT (sizeof(HBM_COMPS) / sizeof(HBM_COMPS[0]))
+
+typedef struct HBM_options {
+    uint32_t lines;
+    // Proportions of the lines, the rest being instructions
+    double labelDensity;
+    double commentRatio;
+    // Proportion of blank lines, and of indented lines with a trailing
+    // comment
+    double whitespaceRatio;
+    uint32_t variables;
+    uint64_t seed;
+    bool emit;
+} HBM_options;
+
+// Growable text buffer
+typedef struct HBM_text {
+    char* data;
+    size_t length;
+    size_t capacity;
+} HBM_text;
+
+static void HBM_append(HBM_text* p_text, const char* chars, size_t length) {
+    if (p_text->length + length > p_text->capacity) {
+        size_t newCapacity = p_text->capacity == 0 ? HBM_INITIAL_CAPACITY
+                                                   : 2 * p_text->capacity;
+        while (newCapacity < p_text->length + length) {
+            newCapacity *= 2;
+        }
+        char* newData = realloc(p_text->data, newCapacity);
+        if (newData == NULL) {
+            fprintf(stderr, "Could not grow the program to %zu bytes\n",
+                    newCapacity);
+            exit(1);
+        }
+        p_text->data = newData;
+        p_text->capacity = newCapacity;
+    }
+    memcpy(p_text->data + p_text->length, chars, length);
+    p_text->length += length;
+}
+
+// xorshift64*, so that a seed always gives the same program
+static uint64_t HBM_random(uint64_t* p_state) {
+    *p_state ^= *p_state >> 12;
+    *p_state ^= *p_state << 25;
+    *p_state ^= *p_state >> 27;
+    return *p_state * 2685821657736338717ULL;
+}
+
+// Returns a number in [0, 1)
+static double HBM_uniform(uint64_t* p_state) {
+    return (HBM_random(p_state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void HBM_generate(const HBM_options* p_options, HBM_text* p_text) {
+    uint64_t state = p_options->seed == 0 ? 1 : p_options->seed;
+    // The references go to labels up to labelCount, so about half of them
+    // are forward references, resolved as fixups
+    uint32_t labelCount =
+        (uint32_t)(p_options->lines * p_options->labelDensity) + 1;
+    uint32_t nextLabel = 0;
+    char line[64];
+    for (uint32_t i = 0; i < p_options->lines; ++i) {
+        double kind = HBM_uniform(&state);
+        bool indented = HBM_uniform(&state) < p_options->whitespaceRatio;
+        int length = 0;
+        if (kind < p_options->commentRatio) {
+            length = snprintf(line, sizeof(line), "// Comment line %u\n", i);
+        } else if ((kind -= p_options->commentRatio) <
+                   p_options->whitespaceRatio / 2) {
+            length = snprintf(line, sizeof(line), "%s\n",
+                              indented ? "    " : "");
+        } else if ((kind -= p_options->whitespaceRatio / 2) <
+                   p_options->labelDensity) {
+            length = snprintf(line, sizeof(line), "(LABEL_%u)\n", nextLabel++);
+        } else {
+            const char* indent = indented ? "    " : "";
+            const char* comment = indented ? " // trailing comment" : "";
+            uint64_t choice = HBM_random(&state);
+            if (choice % 2 == 0) {
+                length = snprintf(line, sizeof(line), "%s%s%s\n", indent,
+                                  HBM_COMPS[(choice >> 8) % HBM_COMP_COUNT],
+                                  comment);
+            } else if (choice % 6 == 1 && p_options->variables > 0) {
+                length = snprintf(line, sizeof(line), "%s@var_%u%s\n", indent,
+                                  (uint32_t)((choice >> 8) %
+                                             p_options->variables),
+                                  comment);
+            } else if (choice % 6 == 3) {
+                length = snprintf(line, sizeof(line), "%s@%u%s\n", indent,
+                                  (uint32_t)((choice >> 8) % 32768), comment);
+            } else {
+                length = snprintf(line, sizeof(line), "%s@LABEL_%u%s\n",
+                                  indent,
+                                  (uint32_t)((choice >> 8) % labelCount),
+                                  comment);
+            }
+        }
+        HBM_append(p_text, line, length);
+    }
+    // Every referenced label is defined, the others would become variables
+    for (; nextLabel < labelCount; ++nextLabel) {
+        int length =
+            snprintf(line, sizeof(line), "(LABEL_%u)\n", nextLabel);
+        HBM_append(p_text, line, length);
+    }
+}
+
+static double HBM_seconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static void HBM_report(const char* phase, double seconds, uint32_t lines) {
+    printf("%-9s %9.4f s %10.2f M lines/s\n", phase, seconds,
+           seconds > 0 ? lines / seconds * 1e-6 : 0.0);
+}
+
+static void HBM_print_help() {
+    printf("HackBenchmark : times the phases of the assembler\n");
+    printf("Usage : HackBenchmark [options]\n");
+    printf("Options :\n");
+    printf("  --lines=N        lines of the program (default : 1000000)\n");
+    printf("  --labels=R       proportion of label lines (default : 0.05)\n");
+    printf("  --variables=N    count of variables (default : 100)\n");
+    printf("  --comments=R     proportion of comment lines (default : 0.2)\n");
+    printf("  --whitespace=R   proportion of blank lines, and of indented\n");
+    printf("                   lines with a comment (default : 0.2)\n");
+    printf("  --seed=N         seed of the generator (default : 1)\n");
+    printf("  --emit           writes the program on stdout instead\n");
+}
+
+static bool HBM_parse_arguments(int argc, char** argv,
+                                HBM_options* p_options) {
+    p_options->lines = 1000000;
+    p_options->labelDensity = 0.05;
+    p_options->variables = 100;
+    p_options->commentRatio = 0.2;
+    p_options->whitespaceRatio = 0.2;
+    p_options->seed = 1;
+    p_options->emit = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--lines=", 8) == 0) {
+            p_options->lines = strtoul(argv[i] + 8, NULL, 10);
+        } else if (strncmp(argv[i], "--labels=", 9) == 0) {
+            p_options->labelDensity = atof(argv[i] + 9);
+        } else if (strncmp(argv[i], "--variables=", 12) == 0) {
+            p_options->variables = strtoul(argv[i] + 12, NULL, 10);
+        } else if (strncmp(argv[i], "--comments=", 11) == 0) {
+            p_options->commentRatio = atof(argv[i] + 11);
+        } else if (strncmp(argv[i], "--whitespace=", 13) == 0) {
+            p_options->whitespaceRatio = atof(argv[i] + 13);
+        } else if (strncmp(argv[i], "--seed=", 7) == 0) {
+            p_options->seed = strtoull(argv[i] + 7, NULL, 10);
+        } else if (strcmp(argv[i], "--emit") == 0) {
+            p_options->emit = true;
+        } else {
+            printf("Unknown argument %s.\n", argv[i]);
+            return false;
+        }
+    }
+    double special = p_options->labelDensity + p_options->commentRatio +
+                     p_options->whitespaceRatio / 2;
+    if (p_options->labelDensity < 0 || p_options->commentRatio < 0 ||
+        p_options->whitespaceRatio < 0 || p_options->whitespaceRatio > 1 ||
+        special >= 1) {
+        printf("The proportions must leave room for instructions.\n");
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    HBM_options options;
+    if (!HBM_parse_arguments(argc, argv, &options)) {
+        HBM_print_help();
+        return 1;
+    }
+    HBM_text text = {NULL, 0, 0};
+    HBM_generate(&options, &text);
+    if (options.emit) {
+        bool written = fwrite(text.data, 1, text.length, stdout) == text.length;
+        free(text.data);
+        return written ? 0 : 1;
+    }
+    uint32_t lines = options.lines;
+
+    // Lexing alone
+    double start = HBM_seconds();
+    HackLexer lexer;
+    HL_init(&lexer, text.data, text.length);
+    HackLine line;
+    uint32_t meaningful = 0;
+    while (HL_next_line(&lexer, &line)) {
+        meaningful++;
+    }
+    double lexTime = HBM_seconds() - start;
+
+    // The phases of source_to_machine_code
+    HackInstructions list;
+    HI_init(&list);
+    HackSymbolTable table;
+    ST_initialise(&table);
+    HackFixups fixups;
+    HF_init(&fixups);
+    HackDiagnostics diag;
+    HD_init(&diag, true);
+    start = HBM_seconds();
+    HL_init(&lexer, text.data, text.length);
+    while (HL_next_line(&lexer, &line)) {
+        parser_add_line(&line, &list, &table, &fixups, &diag);
+    }
+    double encodeTime = HBM_seconds() - start;
+    uint32_t fixupCount = fixups.size;
+    start = HBM_seconds();
+    uint16_t variableCount = parser_resolve_fixups(&fixups, &list, &table);
+    double resolveTime = HBM_seconds() - start;
+
+    FILE* sink = fopen("/dev/null", "w");
+    start = HBM_seconds();
+    bool written = sink != NULL && HI_write_text(&list, sink);
+    double outputTime = HBM_seconds() - start;
+    if (sink != NULL) {
+        fclose(sink);
+    }
+    uint32_t instructionCount = list.size;
+    HF_delete_all_fixups(&fixups);
+    HI_delete_all_instructions(&list);
+    ST_delete_all_entries(&table);
+
+    int jobs = HP_available_jobs();
+    HI_init(&list);
+    ST_initialise(&table);
+    start = HBM_seconds();
+    source_to_machine_code_parallel(text.data, text.length, &list, &table,
+                                    jobs, &diag);
+    double parallelTime = HBM_seconds() - start;
+    HI_delete_all_instructions(&list);
+    ST_delete_all_entries(&table);
+
+    printf("%u lines, %.1f MB : %u instructions, %u meaningful lines, %u "
+           "fixups, %u variables\n",
+           lines, text.length / 1e6, instructionCount, meaningful, fixupCount,
+           variableCount);
+    HBM_report("lex", lexTime, lines);
+    HBM_report("encode", encodeTime, lines);
+    HBM_report("resolve", resolveTime, lines);
+    HBM_report("output", outputTime, lines);
+    HBM_report("total", encodeTime + resolveTime + outputTime, lines);
+    HBM_report("parallel", parallelTime, lines);
+    printf("(parallel : lex, encode and resolve with %d jobs)\n", jobs);
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    // ru_maxrss is in kilobytes on Linux
+    printf("Peak RSS %.1f MB\n", usage.ru_maxrss / 1024.0);
+    if (!written) {
+        fprintf(stderr, "Could not write the machine code\n");
+    }
+    free(text.data);
+    return written && diag.errorCount == 0 ? 0 : 1;
+}
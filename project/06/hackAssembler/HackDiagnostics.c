@@ -0,0 +1,39 @@
+#include "HackDiagnostics.h"
+
+#include <string.h>
+
+void HD_init(HackDiagnostics* p_diag, bool print) {
+    p_diag->print = print;
+    p_diag->errorCount = 0;
+    p_diag->firstErrorLine = 0;
+    p_diag->firstError[0] = '\0';
+}
+
+void HD_error(HackDiagnostics* p_diag, uint32_t lineNumber, const char* format,
+              ...) {
+    char message[HD_MESSAGE_SIZE];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, HD_MESSAGE_SIZE, format, args);
+    va_end(args);
+
+    if (p_diag == NULL || p_diag->print) {
+        fprintf(stderr, "%s on line %u\n", message, lineNumber);
+    }
+    if (p_diag == NULL) {
+        return;
+    }
+    if (p_diag->errorCount == 0) {
+        p_diag->firstErrorLine = lineNumber;
+        memcpy(p_diag->firstError, message, HD_MESSAGE_SIZE);
+    }
+    p_diag->errorCount++;
+}
+
+void HD_merge(HackDiagnostics* p_diag, const HackDiagnostics* other) {
+    if (p_diag->errorCount == 0 && other->errorCount > 0) {
+        p_diag->firstErrorLine = other->firstErrorLine;
+        memcpy(p_diag->firstError, other->firstError, HD_MESSAGE_SIZE);
+    }
+    p_diag->errorCount += other->errorCount;
+}
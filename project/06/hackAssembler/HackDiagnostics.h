@@ -0,0 +1,32 @@
+#ifndef HACKDIAGNOSTICS_H_
+#define HACKDIAGNOSTICS_H_
+
+#define HD_MESSAGE_SIZE 128
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Errors found while assembling a source
+// Only the count and the first error are kept, so that a caller without a
+// terminal (the library) can still report what went wrong
+typedef struct HackDiagnostics HackDiagnostics;
+struct HackDiagnostics {
+    // Every error is also printed on stderr if true
+    bool print;
+    uint32_t errorCount;
+    // Line and message of the first error, valid if errorCount > 0
+    uint32_t firstErrorLine;
+    char firstError[HD_MESSAGE_SIZE];
+};
+
+void HD_init(HackDiagnostics* p_diag, bool print);
+// Records an error found on lineNumber, printf-style
+// A NULL p_diag only prints the error on stderr
+void HD_error(HackDiagnostics* p_diag, uint32_t lineNumber, const char* format,
+              ...);
+// Adds the errors of other after the ones of p_diag
+void HD_merge(HackDiagnostics* p_diag, const HackDiagnostics* other);
+
+#endif  // HACKDIAGNOSTICS_H_
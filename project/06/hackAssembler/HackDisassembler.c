@@ -0,0 +1,390 @@
+// Disassembler for .hack text and raw ROM images
+// Usage : HackDisassembler [options] file > file.asm
+// Every C instruction word is decoded by a single lookup in a table of
+// the 8192 C words, built at start by encoding every dest, comp and jump
+// mnemonic with set_CInstruction, so both directions share one encoding.
+//
+// Labels are written for the targets of the jumps (an @N followed by a
+// jumping C instruction), and for the ROM symbols of the --map file of
+// HackAssembler, whose names are used instead of L<address>. The variables
+// of the map are added as comments after the A instructions that address
+// memory, since naming them could change their addresses when the output
+// is assembled again. So the output assembles back to the same words.
+#include <string.h>
+
+#include "HackInstruction.h"
+#include "HackLexer.h"
+#include "HackListing.h"
+
+// The 3 high bits of a C instruction are set, the other 13 index the table
+#define HDA_C_WORDS 8192
+// "AMD=D|M;JMP" and the null
+#define HDA_TEXT_SIZE 12
+
+static const char* const HDA_COMPS[] = {
+    "0",   "1",   "-1",  "D",   "A",   "!D",  "!A",  "-D",  "-A",  "D+1",
+    "A+1", "D-1", "A-1", "D+A", "D-A", "A-D", "D&A", "D|A", "M",   "!M",
+    "-M",  "M+1", "M-1", "D+M", "D-M", "M-D", "D&M", "D|M"};
+static const char* const HDA_DESTS[] = {"",   "M",  "D",  "MD",
+                                        "A",  "AM", "AD", "AMD"};
+static const char* const HDA_JUMPS[] = {"",    "JGT", "JEQ", "JGE",
+                                        "JLT", "JNE", "JLE", "JMP"};
+#define HDA_COUNT(array) (sizeof(array) / sizeof(array[0]))
+
+// Text of every C word, empty for the comps that have no mnemonic
+static char cText[HDA_C_WORDS][HDA_TEXT_SIZE];
+
+typedef struct HDA_symbols {
+    HLS_symbol* symbols;
+    uint32_t size;
+    uint32_t capacity;
+} HDA_symbols;
+
+static void HDA_init_table() {
+    for (size_t c = 0; c < HDA_COUNT(HDA_COMPS); ++c) {
+        for (size_t d = 0; d < HDA_COUNT(HDA_DESTS); ++d) {
+            for (size_t j = 0; j < HDA_COUNT(HDA_JUMPS); ++j) {
+                HackSlice dest = {HDA_DESTS[d], strlen(HDA_DESTS[d])};
+                HackSlice comp = {HDA_COMPS[c], strlen(HDA_COMPS[c])};
+                HackSlice jump = {HDA_JUMPS[j], strlen(HDA_JUMPS[j])};
+                HackInstruction word;
+                set_CInstruction(&word, &dest, &comp, &jump);
+                snprintf(cText[word & (HDA_C_WORDS - 1)], HDA_TEXT_SIZE,
+                         "%s%s%s%s%s", HDA_DESTS[d], d > 0 ? "=" : "",
+                         HDA_COMPS[c], j > 0 ? ";" : "", HDA_JUMPS[j]);
+            }
+        }
+    }
+}
+
+static void HDA_push_symbol(HDA_symbols* p_symbols, const HLS_symbol* symbol) {
+    if (p_symbols->size == p_symbols->capacity) {
+        p_symbols->capacity =
+            p_symbols->capacity == 0 ? 256 : 2 * p_symbols->capacity;
+        HLS_symbol* newSymbols = realloc(
+            p_symbols->symbols, p_symbols->capacity * sizeof(HLS_symbol));
+        if (newSymbols == NULL) {
+            fprintf(stderr, "Could not grow the symbols array\n");
+            exit(1);
+        }
+        p_symbols->symbols = newSymbols;
+    }
+    p_symbols->symbols[p_symbols->size++] = *symbol;
+}
+
+static int HDA_compare_symbols(const void* p_a, const void* p_b) {
+    uint32_t a = ((const HLS_symbol*)p_a)->address;
+    uint32_t b = ((const HLS_symbol*)p_b)->address;
+    return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+// The maps of HackAssembler are sorted already, and are left in their
+// order, since qsort would not keep the order of the names of an address
+static void HDA_sort(HDA_symbols* p_symbols) {
+    for (uint32_t i = 1; i < p_symbols->size; ++i) {
+        if (p_symbols->symbols[i - 1].address >
+            p_symbols->symbols[i].address) {
+            qsort(p_symbols->symbols, p_symbols->size, sizeof(HLS_symbol),
+                  HDA_compare_symbols);
+            return;
+        }
+    }
+}
+
+// Reads the "ROM 00042 name" and "RAM 00016 name" lines of a map
+// Returns false if a line is not a symbol
+static bool HDA_read_map(const HackSource* p_map, HDA_symbols* p_rom,
+                         HDA_symbols* p_ram) {
+    const char* line = p_map->data;
+    const char* end = p_map->data + p_map->length;
+    while (line < end) {
+        const char* lineEnd = memchr(line, '\n', end - line);
+        lineEnd = lineEnd == NULL ? end : lineEnd;
+        const char* name = line + 4;
+        HLS_symbol symbol;
+        symbol.address = 0;
+        while (name < lineEnd && *name >= '0' && *name <= '9') {
+            symbol.address = 10 * symbol.address + (*name++ - '0');
+        }
+        if (lineEnd - line < 7 || name == line + 4 || name == lineEnd ||
+            *name != ' ' ||
+            (memcmp(line, "ROM ", 4) != 0 && memcmp(line, "RAM ", 4) != 0)) {
+            return false;
+        }
+        symbol.name.start = name + 1;
+        symbol.name.length = lineEnd - symbol.name.start;
+        // Tolerate a map written with CRLF line endings
+        if (symbol.name.length > 0 &&
+            symbol.name.start[symbol.name.length - 1] == '\r') {
+            symbol.name.length--;
+        }
+        symbol.rom = line[1] == 'O';
+        HDA_push_symbol(symbol.rom ? p_rom : p_ram, &symbol);
+        line = lineEnd + 1;
+    }
+    HDA_sort(p_rom);
+    HDA_sort(p_ram);
+    return true;
+}
+
+// Returns the first symbol at address, or NULL
+static const HLS_symbol* HDA_find(const HDA_symbols* p_symbols,
+                                  uint32_t address) {
+    uint32_t low = 0;
+    uint32_t high = p_symbols->size;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (p_symbols->symbols[middle].address < address) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low < p_symbols->size && p_symbols->symbols[low].address == address) {
+        return p_symbols->symbols + low;
+    }
+    return NULL;
+}
+
+// Decodes the .hack text in p_input
+// Returns false on a line that is not 16 '0'/'1'
+static bool HDA_read_text(const HackSource* p_input, HackInstructions* p_list) {
+    const char* line = p_input->data;
+    const char* end = p_input->data + p_input->length;
+    uint32_t lineNumber = 1;
+    while (line < end) {
+        const char* lineEnd = memchr(line, '\n', end - line);
+        lineEnd = lineEnd == NULL ? end : lineEnd;
+        const char* textEnd = lineEnd;
+        if (textEnd > line && textEnd[-1] == '\r') {
+            textEnd--;
+        }
+        if (textEnd > line) {
+            HackInstruction word = 0;
+            bool valid = textEnd - line == 16;
+            for (const char* c = line; valid && c < textEnd; ++c) {
+                valid = *c == '0' || *c == '1';
+                word = word << 1 | (*c == '1');
+            }
+            if (!valid) {
+                fprintf(stderr, "Invalid word on line %u\n", lineNumber);
+                return false;
+            }
+            HI_push_back(p_list, word);
+        }
+        lineNumber++;
+        line = lineEnd + 1;
+    }
+    return true;
+}
+
+static void HDA_read_binary(const HackSource* p_input, HackInstructions* p_list,
+                            bool bigEndian) {
+    const unsigned char* bytes = (const unsigned char*)p_input->data;
+    uint32_t count = p_input->length / 2;
+    HI_resize(p_list, count);
+    for (uint32_t i = 0; i < count; ++i) {
+        p_list->words[i] = bigEndian ? bytes[2 * i] << 8 | bytes[2 * i + 1]
+                                     : bytes[2 * i] | bytes[2 * i + 1] << 8;
+    }
+    if (p_input->length % 2 != 0) {
+        fprintf(stderr, "Ignoring the odd last byte of the ROM image\n");
+    }
+}
+
+// Returns true if the input only holds the chars of a .hack file
+static bool HDA_is_text(const HackSource* p_input) {
+    for (size_t i = 0; i < p_input->length; ++i) {
+        char c = p_input->data[i];
+        if (c != '0' && c != '1' && c != '\n' && c != '\r') {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool HDA_reads_or_writes_memory(HackInstruction word) {
+    return HI_IS_C(word) &&
+           ((HI_COMP(word) & HI_COMP_M) || (HI_DEST(word) & HI_DEST_M));
+}
+
+static void HDA_disassemble(const HackInstructions* p_list,
+                            const HDA_symbols* p_rom,
+                            const HDA_symbols* p_ram, FILE* stream) {
+    // The targets of the jumps, which get a label even without a map
+    bool* targets = calloc((size_t)p_list->size + 1, sizeof(bool));
+    if (targets == NULL) {
+        fprintf(stderr, "Could not allocate the jump targets\n");
+        exit(1);
+    }
+    for (uint32_t i = 0; i + 1 < p_list->size; ++i) {
+        HackInstruction next = p_list->words[i + 1];
+        if (!(p_list->words[i] & 0x8000) && HI_IS_C(next) &&
+            HI_JUMP(next) != 0 && p_list->words[i] <= p_list->size) {
+            targets[p_list->words[i]] = true;
+        }
+    }
+
+    uint32_t unknownCount = 0;
+    uint32_t nextSymbol = 0;
+    for (uint32_t address = 0; address <= p_list->size; ++address) {
+        bool named = false;
+        while (nextSymbol < p_rom->size &&
+               p_rom->symbols[nextSymbol].address <= address) {
+            const HLS_symbol* p_symbol = p_rom->symbols + nextSymbol++;
+            if (p_symbol->address == address) {
+                fprintf(stream, "(%.*s)\n", (int)p_symbol->name.length,
+                        p_symbol->name.start);
+                named = true;
+            }
+        }
+        if (!named && targets[address]) {
+            fprintf(stream, "(L%u)\n", address);
+        }
+        if (address == p_list->size) {
+            break;
+        }
+
+        HackInstruction word = p_list->words[address];
+        if (!(word & 0x8000)) {
+            HackInstruction next =
+                address + 1 < p_list->size ? p_list->words[address + 1] : 0;
+            const HLS_symbol* p_symbol = NULL;
+            if (HI_IS_C(next) && HI_JUMP(next) != 0 &&
+                word <= p_list->size && targets[word]) {
+                p_symbol = HDA_find(p_rom, word);
+                if (p_symbol == NULL) {
+                    fprintf(stream, "@L%u\n", word);
+                    continue;
+                }
+            } else if (HDA_reads_or_writes_memory(next)) {
+                p_symbol = HDA_find(p_ram, word);
+            }
+            if (p_symbol == NULL) {
+                fprintf(stream, "@%u\n", word);
+            } else if (p_symbol->rom) {
+                fprintf(stream, "@%.*s\n", (int)p_symbol->name.length,
+                        p_symbol->name.start);
+            } else {
+                fprintf(stream, "@%u // %.*s\n", word,
+                        (int)p_symbol->name.length, p_symbol->name.start);
+            }
+        } else if (HI_IS_C(word) && cText[word & (HDA_C_WORDS - 1)][0]) {
+            fprintf(stream, "%s\n", cText[word & (HDA_C_WORDS - 1)]);
+        } else {
+            // No mnemonic gives this word, it can't be assembled again
+            fprintf(stream, "// Unknown instruction ");
+            for (int bit = 15; bit >= 0; --bit) {
+                fputc('0' + ((word >> bit) & 1), stream);
+            }
+            fputc('\n', stream);
+            unknownCount++;
+        }
+    }
+    if (unknownCount > 0) {
+        fprintf(stderr, "%u words are not valid instructions\n", unknownCount);
+    }
+    free(targets);
+}
+
+static void HDA_print_help() {
+    printf("HackDisassembler : decodes machine code back into assembly\n");
+    printf("Usage : HackDisassembler [options] [filename] > file.asm\n");
+    printf("Reads the code from standard input if filename is -\n");
+    printf("Options :\n");
+    printf("  --format=hack    .hack text input\n");
+    printf("  --format=bin     raw ROM image of 16-bit words\n");
+    printf("                   (default : guessed from the content)\n");
+    printf("  --endian=little  byte order of the ROM image (default)\n");
+    printf("  --endian=big\n");
+    printf("  --map=FILE       names the labels and variables with the map\n");
+    printf("                   written by HackAssembler --map\n");
+}
+
+// Loads the file at path, or stdin for "-"
+static bool HDA_load(const char* path, HackSource* p_source) {
+    bool fromStdin = strcmp(path, "-") == 0;
+    FILE* stream = fromStdin ? stdin : fopen(path, "rb");
+    if (stream == NULL) {
+        fprintf(stderr, "Could not open %s\n", path);
+        return false;
+    }
+    bool loaded = HS_load(p_source, stream);
+    if (!fromStdin) {
+        fclose(stream);
+    }
+    if (!loaded) {
+        fprintf(stderr, "Could not read %s\n", path);
+    }
+    return loaded;
+}
+
+int main(int argc, char** argv) {
+    const char* filename = NULL;
+    const char* mapPath = NULL;
+    // 0 : guessed, 1 : text, 2 : binary
+    int format = 0;
+    bool bigEndian = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--format=hack") == 0) {
+            format = 1;
+        } else if (strcmp(argv[i], "--format=bin") == 0) {
+            format = 2;
+        } else if (strcmp(argv[i], "--endian=little") == 0) {
+            bigEndian = false;
+        } else if (strcmp(argv[i], "--endian=big") == 0) {
+            bigEndian = true;
+        } else if (strncmp(argv[i], "--map=", 6) == 0 && argv[i][6] != '\0') {
+            mapPath = argv[i] + 6;
+        } else if (strncmp(argv[i], "--", 2) == 0 || filename != NULL) {
+            printf("Unknown argument %s.\n", argv[i]);
+            HDA_print_help();
+            return 1;
+        } else {
+            filename = argv[i];
+        }
+    }
+    if (filename == NULL) {
+        printf("One argument expected.\n");
+        HDA_print_help();
+        return 1;
+    }
+
+    HackSource input;
+    if (!HDA_load(filename, &input)) {
+        return 1;
+    }
+    HackSource map = {NULL, 0, false};
+    HDA_symbols rom = {NULL, 0, 0};
+    HDA_symbols ram = {NULL, 0, 0};
+    bool valid = true;
+    if (mapPath != NULL) {
+        valid = HDA_load(mapPath, &map);
+        if (valid && !HDA_read_map(&map, &rom, &ram)) {
+            fprintf(stderr, "%s is not a symbol map\n", mapPath);
+            valid = false;
+        }
+    }
+
+    HackInstructions list;
+    HI_init(&list);
+    if (valid) {
+        if (format == 1 || (format == 0 && HDA_is_text(&input))) {
+            valid = HDA_read_text(&input, &list);
+        } else {
+            HDA_read_binary(&input, &list, bigEndian);
+        }
+    }
+    if (valid) {
+        HDA_init_table();
+        HDA_disassemble(&list, &rom, &ram, stdout);
+        fprintf(stderr, "Disassembled %u words\n", list.size);
+    }
+
+    HI_delete_all_instructions(&list);
+    free(rom.symbols);
+    free(ram.symbols);
+    HS_release(&map);
+    HS_release(&input);
+    return valid ? 0 : 1;
+}
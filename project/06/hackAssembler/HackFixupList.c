@@ -0,0 +1,39 @@
+#include "HackFixupList.h"
+
+// Implementation of the fixups growable array
+
+void HF_init(HackFixups* list) {
+    list->fixups = NULL;
+    list->size = 0;
+    list->capacity = 0;
+}
+
+void HF_push_back(HackFixups* list, uint32_t address, const HackSlice* symbol) {
+    if (list->size == list->capacity) {
+        uint32_t newCapacity =
+            list->capacity == 0 ? HF_INITIAL_CAPACITY : 2 * list->capacity;
+        HackFixup* newFixups =
+            realloc(list->fixups, newCapacity * sizeof(HackFixup));
+        if (newFixups == NULL) {
+            fprintf(stderr, "Could not grow the fixups array to %u\n",
+                    newCapacity);
+            exit(1);
+        }
+        list->fixups = newFixups;
+        list->capacity = newCapacity;
+    }
+    list->fixups[list->size].address = address;
+    list->fixups[list->size].symbol = *symbol;
+    list->size++;
+}
+
+void HF_append(HackFixups* list, const HackFixups* other) {
+    for (uint32_t i = 0; i < other->size; ++i) {
+        HF_push_back(list, other->fixups[i].address, &other->fixups[i].symbol);
+    }
+}
+
+void HF_delete_all_fixups(HackFixups* list) {
+    free(list->fixups);
+    HF_init(list);
+}
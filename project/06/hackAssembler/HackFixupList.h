@@ -0,0 +1,37 @@
+#ifndef HACKFIXUPLIST_H_
+#define HACKFIXUPLIST_H_
+
+#define HF_INITIAL_CAPACITY 256
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "HackTools.h"
+
+// A fixup is an A instruction emitted before its symbol could be resolved.
+// address is the ROM address of the placeholder word to patch.
+// symbol points into the source buffer, which must outlive the fixup.
+typedef struct HackFixup HackFixup;
+struct HackFixup {
+    uint32_t address;
+    HackSlice symbol;
+};
+
+// Growable array of fixups, kept in the order the references appear in the
+// source so that variables can be allocated in first-appearance order.
+typedef struct HackFixups HackFixups;
+struct HackFixups {
+    HackFixup* fixups;
+    uint32_t size;
+    uint32_t capacity;
+};
+
+void HF_init(HackFixups* list);
+// Records that the word at address refers to symbol
+void HF_push_back(HackFixups* list, uint32_t address, const HackSlice* symbol);
+// Appends all the fixups of other at the end of list
+void HF_append(HackFixups* list, const HackFixups* other);
+void HF_delete_all_fixups(HackFixups* list);
+
+#endif  // HACKFIXUPLIST_H_
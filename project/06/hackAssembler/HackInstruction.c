@@ -1,108 +1,201 @@
 #include "HackInstruction.h"
 
+#include <ctype.h>
+
 // Implementation of the Instruction class
 
 void set_AInstruction(HackInstruction* instr, int16_t address) {
-    instr->instruct[0] = 0;
-    tobin(address, 15, instr->instruct + 1);
+    *instr = address & 0x7FFF;
 }
 
-void set_CInstruction(HackInstruction* instr, char* dest, char* comp,
-                      char* jump) {
-    instr->instruct[0] = 1;
-    instr->instruct[1] = 1;
-    instr->instruct[2] = 1;
-
-    // Dest handling
-    if (dest == NULL) {
-        instr->instruct[10] = 0;
-        instr->instruct[11] = 0;
-        instr->instruct[12] = 0;
-    } else {
-        if (strchr(dest, 'A') != NULL) {
-            instr->instruct[10] = 1;
-        } else {
-            instr->instruct[10] = 0;
+// Packs the mnemonic in slice in a key, without whitespace
+// The chars are kept as they are : mnemonics are uppercase in the Hack
+// language, so a lowercase one is unknown
+// Returns HI_NO_KEY for an empty mnemonic, HI_BAD_KEY for a too long one
+static uint32_t mnemonic_key(const HackSlice* slice) {
+    uint32_t key = HI_NO_KEY;
+    int length = 0;
+    for (size_t i = 0; i < slice->length; ++i) {
+        if (isspace((unsigned char)slice->start[i])) {
+            continue;
         }
-        if (strchr(dest, 'D') != NULL) {
-            instr->instruct[11] = 1;
-        } else {
-            instr->instruct[11] = 0;
+        if (++length > HI_MAX_MNEMONIC_LENGTH) {
+            return HI_BAD_KEY;
         }
-        if (strchr(dest, 'M') != NULL) {
-            instr->instruct[12] = 1;
-        } else {
-            instr->instruct[12] = 0;
+        key = key << 8 | HI_KEY1(slice->start[i]);
+    }
+    return key;
+}
+
+// Returns the a bit and the 6 ALU control bits of comp, or -1 if unknown
+static int16_t comp_bits(uint32_t key) {
+    switch (key) {
+        case HI_KEY1('0'):
+            return 42;
+        case HI_KEY1('1'):
+            return 63;
+        case HI_KEY2('-', '1'):
+            return 58;
+        case HI_KEY1('D'):
+            return 12;
+        case HI_KEY1('A'):
+            return 48;
+        case HI_KEY1('M'):
+            return HI_COMP_M | 48;
+        case HI_KEY2('!', 'D'):
+            return 13;
+        case HI_KEY2('!', 'A'):
+            return 49;
+        case HI_KEY2('!', 'M'):
+            return HI_COMP_M | 49;
+        case HI_KEY2('-', 'D'):
+            return 15;
+        case HI_KEY2('-', 'A'):
+            return 51;
+        case HI_KEY2('-', 'M'):
+            return HI_COMP_M | 51;
+        case HI_KEY3('D', '+', '1'):
+            return 31;
+        case HI_KEY3('A', '+', '1'):
+            return 55;
+        case HI_KEY3('M', '+', '1'):
+            return HI_COMP_M | 55;
+        case HI_KEY3('D', '-', '1'):
+            return 14;
+        case HI_KEY3('A', '-', '1'):
+            return 50;
+        case HI_KEY3('M', '-', '1'):
+            return HI_COMP_M | 50;
+        case HI_KEY3('D', '+', 'A'):
+        case HI_KEY3('A', '+', 'D'):
+            return 2;
+        case HI_KEY3('D', '+', 'M'):
+        case HI_KEY3('M', '+', 'D'):
+            return HI_COMP_M | 2;
+        case HI_KEY3('D', '-', 'A'):
+            return 19;
+        case HI_KEY3('D', '-', 'M'):
+            return HI_COMP_M | 19;
+        case HI_KEY3('A', '-', 'D'):
+            return 7;
+        case HI_KEY3('M', '-', 'D'):
+            return HI_COMP_M | 7;
+        case HI_KEY3('D', '&', 'A'):
+        case HI_KEY3('A', '&', 'D'):
+            return 0;
+        case HI_KEY3('D', '&', 'M'):
+        case HI_KEY3('M', '&', 'D'):
+            return HI_COMP_M | 0;
+        case HI_KEY3('D', '|', 'A'):
+        case HI_KEY3('A', '|', 'D'):
+            return 21;
+        case HI_KEY3('D', '|', 'M'):
+        case HI_KEY3('M', '|', 'D'):
+            return HI_COMP_M | 21;
+        default:
+            return -1;
+    }
+}
+
+// Returns the 3 jump bits, or -1 if unknown
+static int16_t jump_bits(uint32_t key) {
+    switch (key) {
+        case HI_KEY3('J', 'G', 'T'):
+            return 1;
+        case HI_KEY3('J', 'E', 'Q'):
+            return 2;
+        case HI_KEY3('J', 'G', 'E'):
+            return 3;
+        case HI_KEY3('J', 'L', 'T'):
+            return 4;
+        case HI_KEY3('J', 'N', 'E'):
+            return 5;
+        case HI_KEY3('J', 'L', 'E'):
+            return 6;
+        case HI_KEY3('J', 'M', 'P'):
+            return 7;
+        default:
+            return -1;
+    }
+}
+
+// Returns the 3 destination bits, or -1 if unknown
+// The registers may be given in any order
+static int16_t dest_bits(const HackSlice* slice) {
+    int16_t bits = 0;
+    for (size_t i = 0; i < slice->length; ++i) {
+        switch (slice->start[i]) {
+            case 'A':
+                bits |= HI_DEST_A;
+                break;
+            case 'D':
+                bits |= HI_DEST_D;
+                break;
+            case 'M':
+                bits |= HI_DEST_M;
+                break;
+            case ' ':
+            case '\t':
+                break;
+            default:
+                return -1;
         }
     }
+    return bits;
+}
+
+bool set_CInstruction(HackInstruction* instr, const HackSlice* dest,
+                      const HackSlice* comp, const HackSlice* jump) {
+    int16_t compBits = comp_bits(mnemonic_key(comp));
+    int16_t destBits = dest_bits(dest);
+    // No jump only when the instruction has no jump field at all
+    int16_t jumpBits = jump->length == 0 ? 0 : jump_bits(mnemonic_key(jump));
+    bool valid = compBits >= 0 && destBits >= 0 && jumpBits >= 0;
 
-    // Comp handling
-    if (strchr(comp, 'M') != NULL) {
-        instr->instruct[3] = 1;
-    } else {
-        instr->instruct[3] = 0;
+    *instr = HI_C_PREFIX;
+    if (compBits >= 0) {
+        *instr |= compBits << HI_COMP_SHIFT;
+    }
+    if (destBits >= 0) {
+        *instr |= destBits << HI_DEST_SHIFT;
     }
-    if (strcmp(comp, "0") == 0) {
-        tobin(42, 6, instr->instruct + 4);
-    } else if (strcmp(comp, "1") == 0) {
-        tobin(63, 6, instr->instruct + 4);
-    } else if (strcmp(comp, "-1") == 0) {
-        tobin(58, 6, instr->instruct + 4);
-    } else if (strcmp(comp, "D") == 0) {
-        tobin(12, 6, instr->instruct + 4);
-    } else if (strcmp(comp, "A") == 0 || strcmp(comp, "M") == 0) {
-        tobin(48, 6, instr->instruct + 4);
-    } else if (strcmp(comp, "!D") == 0) {
-        tobin(13, 6, instr->instruct + 4);
-    } else if (strcmp(comp, "!A") == 0 || strcmp(comp, "!M") == 0) {
-        tobin(49, 6, instr->instruct + 4);
-    } else if (strcmp(comp, "-D") == 0) {
-        tobin(15, 6, instr->instruct + 4);
-    } else if (strcmp(comp, "-A") == 0 || strcmp(comp, "-M") == 0) {
-        tobin(51, 6, instr->instruct + 4);
-    } else if (strcmp(comp, "D+1") == 0) {
-        tobin(31, 6, instr->instruct + 4);
-    } else if (strcmp(comp, "A+1") == 0 || strcmp(comp, "M+1") == 0) {
-        tobin(55, 6, instr->instruct + 4);
-    } else if (strcmp(comp, "D-1") == 0) {
-        tobin(14, 6, instr->instruct + 4);
-    } else if (strcmp(comp, "A-1") == 0 || strcmp(comp, "M-1") == 0) {
-        tobin(50, 6, instr->instruct + 4);
-    } else if (strcmp(comp, "D+A") == 0 || strcmp(comp, "D+M") == 0) {
-        tobin(2, 6, instr->instruct + 4);
-    } else if (strcmp(comp, "D-A") == 0 || strcmp(comp, "D-M") == 0) {
-        tobin(19, 6, instr->instruct + 4);
-    } else if (strcmp(comp, "A-D") == 0 || strcmp(comp, "M-D") == 0) {
-        tobin(7, 6, instr->instruct + 4);
-    } else if (strcmp(comp, "D&A") == 0 || strcmp(comp, "D&M") == 0) {
-        tobin(0, 6, instr->instruct + 4);
-    } else if (strcmp(comp, "D|A") == 0 || strcmp(comp, "D|M") == 0) {
-        tobin(21, 6, instr->instruct + 4);
+    if (jumpBits >= 0) {
+        *instr |= jumpBits;
     }
+    return valid;
+}
 
-    // Jump handling
-    if (jump == NULL) {
-        tobin(0, 3, instr->instruct + 13);
-    } else if (strcmp(jump, "JGT") == 0) {
-        tobin(1, 3, instr->instruct + 13);
-    } else if (strcmp(jump, "JEQ") == 0) {
-        tobin(2, 3, instr->instruct + 13);
-    } else if (strcmp(jump, "JGE") == 0) {
-        tobin(3, 3, instr->instruct + 13);
-    } else if (strcmp(jump, "JLT") == 0) {
-        tobin(4, 3, instr->instruct + 13);
-    } else if (strcmp(jump, "JNE") == 0) {
-        tobin(5, 3, instr->instruct + 13);
-    } else if (strcmp(jump, "JLE") == 0) {
-        tobin(6, 3, instr->instruct + 13);
-    } else if (strcmp(jump, "JMP") == 0) {
-        tobin(7, 3, instr->instruct + 13);
+uint16_t HI_alu(uint16_t comp, uint16_t x, uint16_t y) {
+    // Control bits, from c1 to c6 : zx nx zy ny f no
+    if (comp & 0x20) {
+        x = 0;
+    }
+    if (comp & 0x10) {
+        x = ~x;
     }
+    if (comp & 0x08) {
+        y = 0;
+    }
+    if (comp & 0x04) {
+        y = ~y;
+    }
+    uint16_t out = (comp & 0x02) ? (uint16_t)(x + y) : (uint16_t)(x & y);
+    if (comp & 0x01) {
+        out = ~out;
+    }
+    return out;
+}
+
+bool HI_jumps(uint16_t jump, uint16_t out) {
+    int16_t value = (int16_t)out;
+    return ((jump & HI_JUMP_LT) && value < 0) ||
+           ((jump & HI_JUMP_EQ) && value == 0) ||
+           ((jump & HI_JUMP_GT) && value > 0);
 }
 
 void printInstruction(HackInstruction* instr) {
-    for (int i = 0; i <= 15; ++i) {
-        printf("%d", instr->instruct[i]);
+    for (int i = 15; i >= 0; --i) {
+        printf("%d", (*instr >> i) & 1);
     }
     printf("\n");
 }
@@ -8,23 +8,48 @@
 
 #include "HackTools.h"
 
-typedef struct HackInstruction HackInstruction;
-struct HackInstruction {
-    // line Number or Address of instruction in ROM
-    uint32_t lineNumber;
-    HackInstruction* next;
-
-    // Concat these from top to bottom to get
-    // instruction from LSB[15] to MSB[0]
-    bool instruct[16];
-    /* 1 wide : A or C instruction [0]
-     * 2 wide : 1s of C instruction [1-2]
-     * 1 wide : A or M register in ALU [3]
-     * 6 wide : ALU control bits [4-9]
-     * 3 wide : destination bits [10:A ; 11:D ; 12:M]
-     * 3 wide : jump bits [13:<0 ; 14:0 ; 15:>0]
-     */
-};
+// A Hack instruction is stored as the 16-bit word that ends up in ROM
+// Bits from MSB[15] to LSB[0] :
+/* 1 wide : A or C instruction [15]
+ * 2 wide : 1s of C instruction [14-13]
+ * 1 wide : A or M register in ALU [12]
+ * 6 wide : ALU control bits [11-6]
+ * 3 wide : destination bits [5:A ; 4:D ; 3:M]
+ * 3 wide : jump bits [2:<0 ; 1:0 ; 0:>0]
+ */
+typedef uint16_t HackInstruction;
+
+#define HI_C_PREFIX 0xE000
+#define HI_A_BIT_SHIFT 12
+#define HI_COMP_SHIFT 6
+// a bit, relative to the comp field
+#define HI_COMP_M (1 << (HI_A_BIT_SHIFT - HI_COMP_SHIFT))
+#define HI_DEST_SHIFT 3
+#define HI_DEST_A 0x4
+#define HI_DEST_D 0x2
+#define HI_DEST_M 0x1
+#define HI_JUMP_GT 0x1
+#define HI_JUMP_EQ 0x2
+#define HI_JUMP_LT 0x4
+
+// Fields of a C instruction word
+#define HI_IS_C(instr) (((instr) & HI_C_PREFIX) == HI_C_PREFIX)
+// a bit and the 6 ALU control bits
+#define HI_COMP(instr) (((instr) >> HI_COMP_SHIFT) & 0x7F)
+#define HI_DEST(instr) (((instr) >> HI_DEST_SHIFT) & 0x7)
+#define HI_JUMP(instr) ((instr) & 0x7)
+
+// Mnemonics are at most 3 chars long, so they are packed in an integer
+// (first char in the most significant byte) and decoded by a switch on
+// compile-time constant keys
+#define HI_KEY1(a) ((uint32_t)(unsigned char)(a))
+#define HI_KEY2(a, b) (HI_KEY1(a) << 8 | HI_KEY1(b))
+#define HI_KEY3(a, b, c) (HI_KEY2(a, b) << 8 | HI_KEY1(c))
+// Key of an empty mnemonic
+#define HI_NO_KEY 0
+// Key of a too long mnemonic, never equal to a packed key of 3 chars
+#define HI_BAD_KEY 0xFFFFFFFFu
+#define HI_MAX_MNEMONIC_LENGTH 3
 
 // Sets the instruction instr to be an A instruction pointing to address
 // Note, address is a 15-bit uint, so an in16_t is perfect to check for
@@ -33,11 +58,20 @@ void set_AInstruction(HackInstruction* instr, int16_t address);
 
 // Sets the instruction instr to be a C instruction using dest(ination),
 // comp(utation) and jump (condition).
-// Any of the strings may be empty, but the caller has to make sure at least
-// one string is not.
-// Also the string in dest, comp and jump must be uppercase without any space
-void set_CInstruction(HackInstruction* instr, char* dest, char* comp,
-                      char* jump);
+// dest and jump may be empty, comp may not.
+// Also the slices in dest, comp and jump must be uppercase. Whitespace inside
+// the slices is ignored.
+// The commuted forms of the binary comps (A+D, M&D, ...) are accepted.
+// Returns false if one of the mnemonics is unknown; the unknown field is
+// then encoded as 0.
+bool set_CInstruction(HackInstruction* instr, const HackSlice* dest,
+                      const HackSlice* comp, const HackSlice* jump);
+
+// Output of the ALU for the comp field (HI_COMP) of a C instruction, x being
+// D, and y being A or M depending on the a bit
+uint16_t HI_alu(uint16_t comp, uint16_t x, uint16_t y);
+// Returns true if the jump field (HI_JUMP) jumps on the ALU output out
+bool HI_jumps(uint16_t jump, uint16_t out);
 
 void printInstruction(HackInstruction* instr);
 
@@ -1,64 +1,122 @@
 #include "HackInstructionList.h"
 
-// Implementation of the Linked list functions
+// Implementation of the growable array functions
 
-void HI_push_back(HackInstructions* list, HackInstruction* instruction) {
-    instruction->next = NULL;
-    if (*list == NULL) {
-        *list = instruction;
-        return;
-    } else {
-        HackInstructions temp = *list;
-        while (temp->next != NULL) {
-            temp = temp->next;
-        }
-        temp->next = instruction;
+void HI_init(HackInstructions* list) {
+    list->words = NULL;
+    list->size = 0;
+    list->capacity = 0;
+}
+
+// Grows the array to hold at least capacity words
+static void HI_reserve(HackInstructions* list, uint32_t capacity) {
+    if (capacity <= list->capacity) {
         return;
     }
+    uint32_t newCapacity =
+        list->capacity == 0 ? HI_INITIAL_CAPACITY : 2 * list->capacity;
+    while (newCapacity < capacity) {
+        newCapacity *= 2;
+    }
+    HackInstruction* newWords =
+        realloc(list->words, newCapacity * sizeof(HackInstruction));
+    if (newWords == NULL) {
+        fprintf(stderr, "Could not grow the instructions array to %u\n",
+                newCapacity);
+        exit(1);
+    }
+    list->words = newWords;
+    list->capacity = newCapacity;
 }
 
-void HI_pop_front(HackInstructions* list) {
-    if (*list == NULL) {
-        return;
-    } else {
-        HackInstructions prev = *list;
-        *list = (*list)->next;
-        // Free any malloc'd memory for list here
-        free(prev);
-        return;
+void HI_push_back(HackInstructions* list, HackInstruction instruction) {
+    if (list->size == list->capacity) {
+        HI_reserve(list, list->size + 1);
     }
+    list->words[list->size++] = instruction;
 }
 
-HackInstruction* HI_front(HackInstructions list) { return list; }
+void HI_resize(HackInstructions* list, uint32_t size) {
+    HI_reserve(list, size);
+    list->size = size;
+}
 
-HackInstruction* HI_back(HackInstructions list) {
-    if (list == NULL) {
+HackInstruction* HI_front(HackInstructions* list) {
+    if (list->size == 0) {
         return NULL;
-    } else {
-        HackInstructions temp = list;
-        while (temp->next != NULL) {
-            temp = temp->next;
-        }
-        return temp;
     }
+    return list->words;
 }
 
-HackInstructions HI_next(HackInstructions list) { return list->next; }
+HackInstruction* HI_back(HackInstructions* list) {
+    if (list->size == 0) {
+        return NULL;
+    }
+    return list->words + list->size - 1;
+}
+
+HackInstruction* HI_at(HackInstructions* list, uint32_t address) {
+    if (address >= list->size) {
+        return NULL;
+    }
+    return list->words + address;
+}
 
 void HI_print_all_instructions(HackInstructions* list) {
-    HackInstructions temp = *list;
-    if (temp == NULL) {
+    if (list->size == 0) {
         fprintf(stderr, "The list is empty now ??\n");
-    } else {
-        while (temp != NULL) {
-            printInstruction(temp);
-            temp = temp->next;
-        }
+    } else if (!HI_write_text(list, stdout)) {
+        fprintf(stderr, "Could not write the instructions\n");
     }
 }
 
-void HI_delete_all_instructions(HackInstructions* list) {
-    while (*list != NULL) {
-        HI_pop_front(list);
+// Binary text of every nibble, MSB first
+static const char nibbleText[16][4] = {
+    {'0', '0', '0', '0'}, {'0', '0', '0', '1'}, {'0', '0', '1', '0'},
+    {'0', '0', '1', '1'}, {'0', '1', '0', '0'}, {'0', '1', '0', '1'},
+    {'0', '1', '1', '0'}, {'0', '1', '1', '1'}, {'1', '0', '0', '0'},
+    {'1', '0', '0', '1'}, {'1', '0', '1', '0'}, {'1', '0', '1', '1'},
+    {'1', '1', '0', '0'}, {'1', '1', '0', '1'}, {'1', '1', '1', '0'},
+    {'1', '1', '1', '1'}};
+
+bool HI_write_text(HackInstructions* list, FILE* stream) {
+    size_t bufferSize = (size_t)list->size * HI_TEXT_WORD_SIZE;
+    char* buffer = malloc(bufferSize);
+    if (buffer == NULL && bufferSize > 0) {
+        return false;
+    }
+    char* out = buffer;
+    for (uint32_t i = 0; i < list->size; ++i) {
+        HackInstruction word = list->words[i];
+        memcpy(out, nibbleText[word >> 12], 4);
+        memcpy(out + 4, nibbleText[(word >> 8) & 0xF], 4);
+        memcpy(out + 8, nibbleText[(word >> 4) & 0xF], 4);
+        memcpy(out + 12, nibbleText[word & 0xF], 4);
+        out[16] = '\n';
+        out += HI_TEXT_WORD_SIZE;
+    }
+    bool written = fwrite(buffer, 1, bufferSize, stream) == bufferSize;
+    free(buffer);
+    return written;
+}
+
+bool HI_write_binary(HackInstructions* list, FILE* stream, bool bigEndian) {
+    size_t bufferSize = (size_t)list->size * 2;
+    unsigned char* buffer = malloc(bufferSize);
+    if (buffer == NULL && bufferSize > 0) {
+        return false;
+    }
+    for (uint32_t i = 0; i < list->size; ++i) {
+        HackInstruction word = list->words[i];
+        buffer[2 * i + (bigEndian ? 0 : 1)] = word >> 8;
+        buffer[2 * i + (bigEndian ? 1 : 0)] = word & 0xFF;
     }
+    bool written = fwrite(buffer, 1, bufferSize, stream) == bufferSize;
+    free(buffer);
+    return written;
+}
+
+void HI_delete_all_instructions(HackInstructions* list) {
+    free(list->words);
+    HI_init(list);
 }
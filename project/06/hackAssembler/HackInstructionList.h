@@ -1,29 +1,47 @@
 #ifndef HACKINSTRUCTIONLIST_H_
 #define HACKINSTRUCTIONLIST_H_
 
+#define HI_INITIAL_CAPACITY 1024
+// 16 digits and a newline
+#define HI_TEXT_WORD_SIZE 17
+
+#include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include "HackInstruction.h"
 
-typedef HackInstruction* HackInstructions;
+// Growable array of encoded instructions
+// The index of an instruction in words is its address in ROM, so
+// push_back is amortised constant time and random access is free.
+typedef struct HackInstructions HackInstructions;
+struct HackInstructions {
+    HackInstruction* words;
+    uint32_t size;
+    uint32_t capacity;
+};
 
-// TODO : List implementation for Instructions
-// Best abstraction for the list would be a queue
-//    push_back is needed
-//    front is needed
-//    pop_front is needed too
-// Best implementation would be using a deque
-//    Constant time insertion/deletion at beginning and end
-//    Constant time random access (indexed by lineNumber) is a bonus
-// For the time being, we'll just use a linked list
+// Initialisation of the array, no allocation is done before the first push
+void HI_init(HackInstructions* list);
 // Push an Instruction at the end of the instructions list
-void HI_push_back(HackInstructions* list, HackInstruction* instruction);
-void HI_pop_front(HackInstructions* list);
+// The capacity is doubled when the array is full
+void HI_push_back(HackInstructions* list, HackInstruction instruction);
+// Sets the size of the list, growing the array if needed
+// New words are left uninitialised, so that they can be written in place
+void HI_resize(HackInstructions* list, uint32_t size);
 // For the accessors it is better to use pointers since the methods of
 // HackInstruction expect addresses
-HackInstruction* HI_front(HackInstructions list);
-HackInstruction* HI_back(HackInstructions list);
-// Iterator
-HackInstructions HI_next(HackInstructions list);
+HackInstruction* HI_front(HackInstructions* list);
+HackInstruction* HI_back(HackInstructions* list);
+HackInstruction* HI_at(HackInstructions* list, uint32_t address);
+// Prints the instructions on stdout in the .hack text format
 void HI_print_all_instructions(HackInstructions* list);
+// Writes the instructions as .hack text, one line of 16 '0'/'1' per word
+// The text is built in a single buffer, using a table of the 16 nibbles
+// Returns false if the buffer could not be allocated or written
+bool HI_write_text(HackInstructions* list, FILE* stream);
+// Writes the instructions as a raw ROM image of 16-bit words, in a single
+// write
+// Returns false if the buffer could not be allocated or written
+bool HI_write_binary(HackInstructions* list, FILE* stream, bool bigEndian);
 void HI_delete_all_instructions(HackInstructions* list);
 #endif  // HACKINSTRUCTIONLIST_H_
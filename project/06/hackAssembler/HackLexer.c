@@ -0,0 +1,238 @@
+#include "HackLexer.h"
+
+#include <ctype.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// The vector scans are compiled for the instruction sets the compiler
+// targets : SSE2 on every x86-64, AVX2 with -mavx2 or -march=native
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+bool HS_load(HackSource* p_source, FILE* filestream) {
+    p_source->data = NULL;
+    p_source->length = 0;
+    p_source->mapped = false;
+
+    struct stat statbuf;
+    int fd = fileno(filestream);
+    if (fstat(fd, &statbuf) == 0 && S_ISREG(statbuf.st_mode)) {
+        if (statbuf.st_size == 0) {
+            return true;
+        }
+        void* mapping =
+            mmap(NULL, statbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            p_source->data = mapping;
+            p_source->length = statbuf.st_size;
+            p_source->mapped = true;
+            return true;
+        }
+    }
+
+    // Fallback for streams that can't be mapped
+    size_t capacity = 0;
+    size_t readBytes = 0;
+    do {
+        if (p_source->length + HS_READ_CHUNK > capacity) {
+            capacity = capacity == 0 ? HS_READ_CHUNK : 2 * capacity;
+            char* newData = realloc(p_source->data, capacity);
+            if (newData == NULL) {
+                HS_release(p_source);
+                return false;
+            }
+            p_source->data = newData;
+        }
+        readBytes = fread(p_source->data + p_source->length, 1,
+                          capacity - p_source->length, filestream);
+        p_source->length += readBytes;
+    } while (readBytes > 0);
+
+    if (ferror(filestream)) {
+        HS_release(p_source);
+        return false;
+    }
+    return true;
+}
+
+void HS_release(HackSource* p_source) {
+    if (p_source->mapped) {
+        munmap(p_source->data, p_source->length);
+    } else {
+        free(p_source->data);
+    }
+    p_source->data = NULL;
+    p_source->length = 0;
+    p_source->mapped = false;
+}
+
+void HL_init(HackLexer* p_lexer, const char* source, size_t length) {
+    p_lexer->cursor = source;
+    p_lexer->end = source + length;
+    p_lexer->lineNumber = 0;
+    p_lexer->block = NULL;
+    p_lexer->mask = 0;
+}
+
+static bool is_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+// Strips the whitespace around [start, end[ and returns it as a slice
+static HackSlice make_slice(const char* start, const char* end) {
+    while (start < end && is_blank(*start)) start++;
+    while (end > start && is_blank(*(end - 1))) end--;
+    HackSlice slice = {start, end - start};
+    return slice;
+}
+
+// Returns the first occurence of c in [start, end[, or end
+static const char* find_char(const char* start, const char* end, char c) {
+    const char* found = memchr(start, c, end - start);
+    return found == NULL ? end : found;
+}
+
+// Returns the mask of the '\n' and '/' of the HL_BLOCK_SIZE chars at block,
+// bit i being set for block[i]
+static uint64_t block_mask(const char* block) {
+#if defined(__AVX2__)
+    const __m256i newlines = _mm256_set1_epi8('\n');
+    const __m256i slashes = _mm256_set1_epi8('/');
+    uint64_t mask = 0;
+    for (int i = 0; i < HL_BLOCK_SIZE; i += 32) {
+        __m256i chars = _mm256_loadu_si256((const __m256i*)(block + i));
+        uint32_t bits = (uint32_t)_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chars, newlines),
+                            _mm256_cmpeq_epi8(chars, slashes)));
+        mask |= (uint64_t)bits << i;
+    }
+    return mask;
+#elif defined(__SSE2__)
+    const __m128i newlines = _mm_set1_epi8('\n');
+    const __m128i slashes = _mm_set1_epi8('/');
+    uint64_t mask = 0;
+    for (int i = 0; i < HL_BLOCK_SIZE; i += 16) {
+        __m128i chars = _mm_loadu_si128((const __m128i*)(block + i));
+        uint32_t bits = (uint32_t)_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(chars, newlines),
+                         _mm_cmpeq_epi8(chars, slashes)));
+        mask |= (uint64_t)bits << i;
+    }
+    return mask;
+#else
+    // Branchless, so that the compiler may vectorise it on its own
+    uint64_t mask = 0;
+    for (int i = 0; i < HL_BLOCK_SIZE; ++i) {
+        mask |= (uint64_t)(block[i] == '\n' || block[i] == '/') << i;
+    }
+    return mask;
+#endif
+}
+
+// Returns the first '\n' or '/' from start, or the end of the source
+// The mask of the last block is kept in the lexer, so that the block is
+// compared once for all the lines it holds. Blocks never go past the end,
+// the last chars are scanned one by one.
+static const char* find_newline_or_slash(HackLexer* p_lexer,
+                                         const char* start) {
+    while (true) {
+        if (p_lexer->block != NULL && start >= p_lexer->block &&
+            start < p_lexer->block + HL_BLOCK_SIZE) {
+            uint64_t mask = p_lexer->mask >> (start - p_lexer->block);
+            if (mask != 0) {
+                return start + __builtin_ctzll(mask);
+            }
+            start = p_lexer->block + HL_BLOCK_SIZE;
+        }
+        if (p_lexer->end - start < HL_BLOCK_SIZE) {
+            break;
+        }
+        p_lexer->block = start;
+        p_lexer->mask = block_mask(start);
+    }
+    while (start < p_lexer->end && *start != '\n' && *start != '/') {
+        start++;
+    }
+    return start;
+}
+
+bool HL_next_line(HackLexer* p_lexer, HackLine* p_line) {
+    while (p_lexer->cursor < p_lexer->end) {
+        // A single scan finds the end of the line or the start of its
+        // comment, the rest of a comment is skipped up to the newline
+        const char* lineStart = p_lexer->cursor;
+        const char* comment = lineStart;
+        const char* lineEnd;
+        while (true) {
+            comment = find_newline_or_slash(p_lexer, comment);
+            if (comment == p_lexer->end || *comment == '\n') {
+                lineEnd = comment;
+                break;
+            }
+            if (comment + 1 < p_lexer->end && *(comment + 1) == '/') {
+                lineEnd = find_newline_or_slash(p_lexer, comment + 2);
+                while (lineEnd < p_lexer->end && *lineEnd != '\n') {
+                    lineEnd = find_newline_or_slash(p_lexer, lineEnd + 1);
+                }
+                break;
+            }
+            comment++;
+        }
+        p_lexer->cursor = lineEnd < p_lexer->end ? lineEnd + 1 : lineEnd;
+        p_lexer->lineNumber++;
+
+        HackSlice content = make_slice(lineStart, comment);
+        // This is needed to skip comment lines
+        if (content.length == 0) {
+            continue;
+        }
+
+        const char* contentEnd = content.start + content.length;
+        p_line->lineNumber = p_lexer->lineNumber;
+        p_line->dest.length = 0;
+        p_line->comp.length = 0;
+        p_line->jump.length = 0;
+        p_line->symbol.length = 0;
+        if (*content.start == '(') {
+            p_line->type = HL_LABEL;
+            p_line->symbol = make_slice(
+                content.start + 1, find_char(content.start, contentEnd, ')'));
+        } else if (*content.start == '@') {
+            p_line->type = HL_A_INSTRUCTION;
+            p_line->symbol = make_slice(content.start + 1, contentEnd);
+        } else {
+            p_line->type = HL_C_INSTRUCTION;
+            const char* equal = find_char(content.start, contentEnd, '=');
+            const char* compStart = content.start;
+            if (equal < contentEnd) {
+                p_line->dest = make_slice(content.start, equal);
+                compStart = equal + 1;
+            }
+            const char* semicolon = find_char(compStart, contentEnd, ';');
+            p_line->comp = make_slice(compStart, semicolon);
+            if (semicolon < contentEnd) {
+                p_line->jump = make_slice(semicolon + 1, contentEnd);
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+bool HL_slice_to_number(const HackSlice* slice, int32_t* value) {
+    // Like strtol, the leading digits are read and the rest is ignored
+    if (slice->length == 0 || !isdigit((unsigned char)slice->start[0])) {
+        return false;
+    }
+    int32_t result = 0;
+    for (size_t i = 0; i < slice->length && isdigit((unsigned char)slice->start[i]);
+         ++i) {
+        // Saturate, the address is truncated to 15 bits anyway
+        if (result < INT32_MAX / 10) {
+            result = result * 10 + (slice->start[i] - '0');
+        }
+    }
+    *value = result;
+    return true;
+}
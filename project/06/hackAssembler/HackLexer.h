@@ -0,0 +1,84 @@
+// In-place lexer for the assembly sources
+// The whole source is mapped in memory (or read once when it can't be
+// mapped) and each line is returned as slices pointing into the source, so
+// no line or token is ever copied.
+#ifndef HACKLEXER_H_
+#define HACKLEXER_H_
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif  // _POSIX_C_SOURCE
+
+#define HS_READ_CHUNK 65536
+// Chars compared at once when looking for the end of a line or a comment
+#define HL_BLOCK_SIZE 64
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "HackTools.h"
+
+// Source buffer of the assembler
+typedef struct HackSource HackSource;
+struct HackSource {
+    char* data;
+    size_t length;
+    // true if data is a mapping of the file, false if it was malloc'd
+    bool mapped;
+};
+
+// Maps the whole content of filestream in p_source.
+// If the stream can't be mapped (pipe, terminal...), it is read until EOF
+// in a single growing buffer instead.
+// Returns false if the stream could not be read
+bool HS_load(HackSource* p_source, FILE* filestream);
+void HS_release(HackSource* p_source);
+
+typedef enum HackLineType {
+    HL_A_INSTRUCTION,
+    HL_C_INSTRUCTION,
+    HL_LABEL
+} HackLineType;
+
+// Meaningful line of the source
+// For an A instruction or a label, symbol holds the value or the label name
+// For a C instruction, dest, comp and jump hold the fields (maybe empty)
+// All slices are stripped of their surrounding whitespace
+typedef struct HackLine HackLine;
+struct HackLine {
+    HackLineType type;
+    HackSlice symbol;
+    HackSlice dest;
+    HackSlice comp;
+    HackSlice jump;
+    // 1-based line number in the source
+    uint32_t lineNumber;
+};
+
+typedef struct HackLexer HackLexer;
+struct HackLexer {
+    const char* cursor;
+    const char* end;
+    uint32_t lineNumber;
+    // Last block scanned for newlines and slashes, and the mask of their
+    // positions in it (see HL_next_line)
+    const char* block;
+    uint64_t mask;
+};
+
+void HL_init(HackLexer* p_lexer, const char* source, size_t length);
+// Reads up to the next meaningful line, skipping blank and comment lines.
+// The newlines and the slashes that may start a comment are found by
+// comparing blocks of HL_BLOCK_SIZE chars at once, with SSE2 or AVX2 when
+// the compiler targets them, so that a block holding several short lines is
+// scanned once.
+// Returns false when the end of the source is reached
+bool HL_next_line(HackLexer* p_lexer, HackLine* p_line);
+
+// Returns true if the slice starts with a digit, and writes the value of
+// its leading decimal number
+bool HL_slice_to_number(const HackSlice* slice, int32_t* value);
+
+#endif  // HACKLEXER_H_
@@ -0,0 +1,31 @@
+#include "HackLibrary.h"
+
+#include <string.h>
+
+#include "HackInstructionList.h"
+#include "HackParser.h"
+#include "HackSymbolTable.h"
+
+size_t hack_assemble(const char* src, size_t len, uint16_t* out, size_t cap,
+                     HackDiagnostics* p_diag) {
+    HackDiagnostics diag;
+    if (p_diag == NULL) {
+        p_diag = &diag;
+    }
+    HD_init(p_diag, false);
+
+    HackInstructions list;
+    HI_init(&list);
+    HackSymbolTable table;
+    ST_initialise(&table);
+    source_to_machine_code(src, len, &list, &table, p_diag);
+
+    size_t wordCount = list.size;
+    size_t copied = wordCount < cap ? wordCount : cap;
+    if (copied > 0) {
+        memcpy(out, list.words, copied * sizeof(uint16_t));
+    }
+    HI_delete_all_instructions(&list);
+    ST_delete_all_entries(&table);
+    return wordCount;
+}
@@ -0,0 +1,24 @@
+// In-process assembler, built as libhackasm.a
+// It uses the same lexer, parser and encoder as HackAssembler, but never
+// writes on stdout : the machine code goes to a caller buffer and the errors
+// to a HackDiagnostics.
+#ifndef HACKLIBRARY_H_
+#define HACKLIBRARY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "HackDiagnostics.h"
+
+// Assembles the len bytes of src, which needs no terminating '\0'.
+// The first (up to) cap words of the program are written in out, which may
+// be NULL if cap is 0.
+// Returns the number of words of the whole program : if it is more than
+// cap, the program was truncated and can be assembled again with a bigger
+// buffer, as with snprintf.
+// The errors are recorded in p_diag, which may be NULL, and are not
+// printed. The program is still assembled, unknown fields encoded as 0.
+size_t hack_assemble(const char* src, size_t len, uint16_t* out, size_t cap,
+                     HackDiagnostics* p_diag);
+
+#endif  // HACKLIBRARY_H_
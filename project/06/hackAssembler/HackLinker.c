@@ -0,0 +1,158 @@
+// Linker for the objects written by HackAssembler --format=obj
+// Usage : HackLinker [--format=hack|bin] [--endian=little|big] a.hobj...
+// The objects are placed one after the other in ROM, in the order of the
+// command line. The labels of all the objects are added to one symbol
+// table (the first definition of a name is kept), then the relocations are
+// patched as the parser patches its fixups : a name that no object defines
+// becomes a variable, from FIRST_VARIABLE_ADDRESS in order of first
+// appearance. The words are written on stdout, as HackAssembler does.
+#include <string.h>
+
+#include "HackInstructionList.h"
+#include "HackLexer.h"
+#include "HackObject.h"
+#include "HackParser.h"
+
+typedef struct HLK_input {
+    const char* path;
+    HackSource file;
+    HackObject object;
+    uint32_t base;
+} HLK_input;
+
+static void HLK_print_help() {
+    printf("HackLinker : links the objects of HackAssembler --format=obj\n");
+    printf("Usage : HackLinker [options] file.hobj... > program.hack\n");
+    printf("Options :\n");
+    printf("  --format=hack    .hack text output (default)\n");
+    printf("  --format=bin     raw ROM image of 16-bit words\n");
+    printf("  --endian=little  byte order of the ROM image (default)\n");
+    printf("  --endian=big\n");
+}
+
+// Loads and reads the object file of p_input
+static bool HLK_load(HLK_input* p_input) {
+    FILE* stream = fopen(p_input->path, "rb");
+    if (stream == NULL) {
+        fprintf(stderr, "Could not open %s\n", p_input->path);
+        return false;
+    }
+    bool loaded = HS_load(&p_input->file, stream);
+    fclose(stream);
+    if (!loaded) {
+        fprintf(stderr, "Could not read %s\n", p_input->path);
+        return false;
+    }
+    if (!HOB_read(&p_input->object, &p_input->file)) {
+        fprintf(stderr, "%s is not a valid object\n", p_input->path);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    bool binary = false;
+    bool bigEndian = false;
+    HLK_input* inputs = malloc(argc * sizeof(HLK_input));
+    if (inputs == NULL) {
+        fprintf(stderr, "Could not allocate the inputs\n");
+        return 1;
+    }
+    int inputCount = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--format=hack") == 0) {
+            binary = false;
+        } else if (strcmp(argv[i], "--format=bin") == 0) {
+            binary = true;
+        } else if (strcmp(argv[i], "--endian=little") == 0) {
+            bigEndian = false;
+        } else if (strcmp(argv[i], "--endian=big") == 0) {
+            bigEndian = true;
+        } else if (strncmp(argv[i], "--", 2) == 0) {
+            printf("Unknown option %s.\n", argv[i]);
+            HLK_print_help();
+            free(inputs);
+            return 1;
+        } else {
+            inputs[inputCount].path = argv[i];
+            inputs[inputCount].file.data = NULL;
+            inputs[inputCount].file.length = 0;
+            inputs[inputCount].file.mapped = false;
+            HOB_init(&inputs[inputCount].object);
+            inputCount++;
+        }
+    }
+    if (inputCount == 0) {
+        printf("At least one object expected.\n");
+        HLK_print_help();
+        free(inputs);
+        return 1;
+    }
+
+    bool linked = true;
+    for (int i = 0; i < inputCount && linked; ++i) {
+        linked = HLK_load(inputs + i);
+    }
+
+    HackInstructions list;
+    HI_init(&list);
+    HackSymbolTable table;
+    ST_initialise(&table);
+    HackFixups fixups;
+    HF_init(&fixups);
+    if (linked) {
+        // Every label is known before the first relocation is patched
+        for (int i = 0; i < inputCount; ++i) {
+            HLK_input* p_input = inputs + i;
+            p_input->base = list.size;
+            HI_resize(&list, list.size + p_input->object.words.size);
+            memcpy(list.words + p_input->base, p_input->object.words.words,
+                   (size_t)p_input->object.words.size *
+                       sizeof(HackInstruction));
+            for (uint32_t j = 0; j < p_input->object.symbolCount; ++j) {
+                const HOB_symbol* p_symbol = p_input->object.symbols + j;
+                if (p_symbol->value == HOB_UNDEFINED) {
+                    continue;
+                }
+                if (ST_check_for_slice(&table, &p_symbol->name) !=
+                    KEY_NOT_FOUND) {
+                    fprintf(stderr,
+                            "%.*s is already defined, ignoring the label of "
+                            "%s\n",
+                            (int)p_symbol->name.length, p_symbol->name.start,
+                            p_input->path);
+                    continue;
+                }
+                ST_add_slice(&table, &p_symbol->name,
+                             p_input->base + p_symbol->value);
+            }
+        }
+        for (int i = 0; i < inputCount; ++i) {
+            const HackObject* p_object = &inputs[i].object;
+            for (uint32_t j = 0; j < p_object->relocationCount; ++j) {
+                const HOB_relocation* p_relocation = p_object->relocations + j;
+                HF_push_back(&fixups, inputs[i].base + p_relocation->address,
+                             &p_object->symbols[p_relocation->symbol].name);
+            }
+        }
+        uint16_t variableCount = parser_resolve_fixups(&fixups, &list, &table);
+        fprintf(stderr, "Linked %d objects, %u instructions and %u variables\n",
+                inputCount, list.size, variableCount);
+        linked = binary ? HI_write_binary(&list, stdout, bigEndian)
+                        : HI_write_text(&list, stdout);
+        if (!linked) {
+            fprintf(stderr, "Could not write the machine code\n");
+        }
+    }
+
+    // The names of the symbols point into the object files
+    HF_delete_all_fixups(&fixups);
+    ST_delete_all_entries(&table);
+    HI_delete_all_instructions(&list);
+    for (int i = 0; i < inputCount; ++i) {
+        HOB_delete_object(&inputs[i].object);
+        HS_release(&inputs[i].file);
+    }
+    free(inputs);
+    return linked ? 0 : 1;
+}
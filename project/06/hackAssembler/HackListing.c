@@ -0,0 +1,171 @@
+#include "HackListing.h"
+
+void HLS_init(HackListing* p_listing) {
+    p_listing->lines = NULL;
+    p_listing->size = 0;
+    p_listing->capacity = 0;
+    p_listing->symbols = NULL;
+    p_listing->symbolCount = 0;
+    p_listing->symbolCapacity = 0;
+    ST_initialise(&p_listing->labels);
+    ST_initialise(&p_listing->seen);
+    STA_init(&p_listing->names);
+}
+
+static void HLS_push_symbol(HackListing* p_listing, const HackSlice* p_name,
+                            uint32_t address, bool rom) {
+    if (p_listing->symbolCount == p_listing->symbolCapacity) {
+        uint32_t newCapacity = p_listing->symbolCapacity == 0
+                                   ? HLS_INITIAL_CAPACITY
+                                   : 2 * p_listing->symbolCapacity;
+        HLS_symbol* newSymbols =
+            realloc(p_listing->symbols, newCapacity * sizeof(HLS_symbol));
+        if (newSymbols == NULL) {
+            fprintf(stderr, "Could not grow the symbol map to %u\n",
+                    newCapacity);
+            exit(1);
+        }
+        p_listing->symbols = newSymbols;
+        p_listing->symbolCapacity = newCapacity;
+    }
+    HLS_symbol* p_symbol = p_listing->symbols + p_listing->symbolCount++;
+    p_symbol->name.start =
+        STA_intern(&p_listing->names, p_name->start, p_name->length);
+    p_symbol->name.length = p_name->length;
+    p_symbol->address = address;
+    p_symbol->rom = rom;
+}
+
+void HLS_add_line(HackListing* p_listing, const HackLine* p_line) {
+    // Labels are kept as the parser keeps them : the first definition wins,
+    // and a predefined symbol can't be redefined
+    if (p_line->type == HL_LABEL) {
+        if (p_line->symbol.length > 0 &&
+            ST_check_for_slice(&p_listing->labels, &p_line->symbol) ==
+                KEY_NOT_FOUND) {
+            ST_add_slice(&p_listing->labels, &p_line->symbol,
+                         p_listing->size);
+            HLS_push_symbol(p_listing, &p_line->symbol, p_listing->size, true);
+        }
+        return;
+    }
+    // A symbol not known as a label yet may be a variable, which is only
+    // told once every label is read
+    int32_t number;
+    if (p_line->type == HL_A_INSTRUCTION &&
+        !HL_slice_to_number(&p_line->symbol, &number) &&
+        ST_check_for_slice(&p_listing->labels, &p_line->symbol) ==
+            KEY_NOT_FOUND &&
+        ST_check_for_slice(&p_listing->seen, &p_line->symbol) ==
+            KEY_NOT_FOUND) {
+        ST_add_slice(&p_listing->seen, &p_line->symbol, 0);
+        HLS_push_symbol(p_listing, &p_line->symbol, 0, false);
+    }
+    if (p_listing->size == p_listing->capacity) {
+        uint32_t newCapacity = p_listing->capacity == 0
+                                   ? HLS_INITIAL_CAPACITY
+                                   : 2 * p_listing->capacity;
+        uint32_t* newLines =
+            realloc(p_listing->lines, newCapacity * sizeof(uint32_t));
+        if (newLines == NULL) {
+            fprintf(stderr, "Could not grow the listing to %u\n", newCapacity);
+            exit(1);
+        }
+        p_listing->lines = newLines;
+        p_listing->capacity = newCapacity;
+    }
+    p_listing->lines[p_listing->size++] = p_line->lineNumber;
+}
+
+void HLS_read(HackListing* p_listing, const char* source, size_t length) {
+    HackLexer lexer;
+    HL_init(&lexer, source, length);
+    HackLine line;
+    while (HL_next_line(&lexer, &line)) {
+        HLS_add_line(p_listing, &line);
+    }
+}
+
+// ROM symbols first, then by address, then by name
+static int HLS_compare_symbols(const void* p_a, const void* p_b) {
+    const HLS_symbol* a = p_a;
+    const HLS_symbol* b = p_b;
+    if (a->rom != b->rom) {
+        return a->rom ? -1 : 1;
+    }
+    if (a->address != b->address) {
+        return a->address < b->address ? -1 : 1;
+    }
+    size_t length =
+        a->name.length < b->name.length ? a->name.length : b->name.length;
+    int order = memcmp(a->name.start, b->name.start, length);
+    if (order != 0) {
+        return order;
+    }
+    return a->name.length < b->name.length   ? -1
+           : a->name.length > b->name.length ? 1
+                                             : 0;
+}
+
+bool HLS_write_map(HackListing* p_listing, HackSymbolTable* p_table,
+                   FILE* stream) {
+    // The referenced symbols that turned out to be labels are dropped, the
+    // others take the address the parser gave them
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < p_listing->symbolCount; ++i) {
+        HLS_symbol symbol = p_listing->symbols[i];
+        if (!symbol.rom) {
+            if (ST_check_for_slice(&p_listing->labels, &symbol.name) !=
+                KEY_NOT_FOUND) {
+                continue;
+            }
+            int64_t address = ST_check_for_slice(p_table, &symbol.name);
+            if (address == KEY_NOT_FOUND) {
+                continue;
+            }
+            symbol.address = address;
+        }
+        p_listing->symbols[kept++] = symbol;
+    }
+    p_listing->symbolCount = kept;
+    if (kept > 0) {
+        qsort(p_listing->symbols, kept, sizeof(HLS_symbol),
+              HLS_compare_symbols);
+    }
+    for (uint32_t i = 0; i < kept; ++i) {
+        const HLS_symbol* p_symbol = p_listing->symbols + i;
+        fprintf(stream, "%s %05u %.*s\n", p_symbol->rom ? "ROM" : "RAM",
+                p_symbol->address, (int)p_symbol->name.length,
+                p_symbol->name.start);
+    }
+    return !ferror(stream);
+}
+
+bool HLS_write_listing(const HackListing* p_listing,
+                       const HackInstructions* p_list, FILE* stream) {
+    char bits[17];
+    for (uint32_t address = 0; address < p_list->size; ++address) {
+        // Line 0 stands for a word that no source line gives
+        uint32_t line = address < p_listing->size ? p_listing->lines[address]
+                                                  : 0;
+        tobinstr(p_list->words[address], 16, bits);
+        // The field is clamped to keep every record the same size
+        fprintf(stream, "%05u %s %07u\n", address, bits,
+                line > 9999999 ? 9999999 : line);
+    }
+    return !ferror(stream);
+}
+
+void HLS_delete_listing(HackListing* p_listing) {
+    free(p_listing->lines);
+    free(p_listing->symbols);
+    p_listing->lines = NULL;
+    p_listing->size = 0;
+    p_listing->capacity = 0;
+    p_listing->symbols = NULL;
+    p_listing->symbolCount = 0;
+    p_listing->symbolCapacity = 0;
+    ST_delete_all_entries(&p_listing->labels);
+    ST_delete_all_entries(&p_listing->seen);
+    STA_release(&p_listing->names);
+}
@@ -0,0 +1,71 @@
+// Symbol map and listing of an assembled program, for the profilers and
+// debuggers that work on the ROM addresses
+// The listing is built from the lines that were encoded, one HackLine at a
+// time, so it follows the optimized program as well as the source.
+// - The .map file gives every label with its ROM address and every variable
+//   with its RAM address, one per line ("ROM 00042 Main.main"), sorted by
+//   address, the ROM symbols first.
+// - The .lst file gives, for every ROM word, its address, its bits and the
+//   source line it comes from. Its records have a fixed size
+//   (HLS_RECORD_SIZE), so the record of an address is found by a seek.
+#ifndef HACKLISTING_H_
+#define HACKLISTING_H_
+
+#define HLS_INITIAL_CAPACITY 1024
+// "00042 0000000000101010 0000017\n"
+#define HLS_RECORD_SIZE 31
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "HackInstructionList.h"
+#include "HackLexer.h"
+#include "HackSymbolTable.h"
+
+// Symbol of the map, name points into the names of the listing
+typedef struct HLS_symbol HLS_symbol;
+struct HLS_symbol {
+    HackSlice name;
+    uint32_t address;
+    // true for a label, false for a variable
+    bool rom;
+};
+
+typedef struct HackListing HackListing;
+struct HackListing {
+    // Source line of each ROM word
+    uint32_t* lines;
+    uint32_t size;
+    uint32_t capacity;
+    // Labels and referenced symbols, in order of first appearance
+    HLS_symbol* symbols;
+    uint32_t symbolCount;
+    uint32_t symbolCapacity;
+    // Labels with their ROM address, and the predefined symbols, as in the
+    // symbol table of the parser
+    HackSymbolTable labels;
+    // Symbols already in symbols
+    HackSymbolTable seen;
+    // Copies of the names, since the optimizer frees the labels it adds
+    // before the map is written
+    ST_arena names;
+};
+
+void HLS_init(HackListing* p_listing);
+// Records p_line, which is encoded right after the previous lines
+void HLS_add_line(HackListing* p_listing, const HackLine* p_line);
+// Records every line of the source
+void HLS_read(HackListing* p_listing, const char* source, size_t length);
+// Writes the map, the variables taking their address in p_table
+// Returns false if the file could not be written
+bool HLS_write_map(HackListing* p_listing, HackSymbolTable* p_table,
+                   FILE* stream);
+// Writes the listing of the words of p_list
+// Returns false if the file could not be written
+bool HLS_write_listing(const HackListing* p_listing,
+                       const HackInstructions* p_list, FILE* stream);
+void HLS_delete_listing(HackListing* p_listing);
+
+#endif  // HACKLISTING_H_
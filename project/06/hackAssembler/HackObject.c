@@ -0,0 +1,232 @@
+#include "HackObject.h"
+
+typedef struct HOB_reader {
+    const unsigned char* cursor;
+    const unsigned char* end;
+    bool valid;
+} HOB_reader;
+
+void HOB_init(HackObject* p_object) {
+    HI_init(&p_object->words);
+    p_object->symbols = NULL;
+    p_object->symbolCount = 0;
+    p_object->symbolCapacity = 0;
+    p_object->relocations = NULL;
+    p_object->relocationCount = 0;
+    p_object->relocationCapacity = 0;
+    ST_initialise(&p_object->index);
+}
+
+static void HOB_push_symbol(HackObject* p_object, const HackSlice* p_name,
+                            uint32_t value) {
+    if (p_object->symbolCount == p_object->symbolCapacity) {
+        uint32_t newCapacity = p_object->symbolCapacity == 0
+                                   ? HOB_INITIAL_CAPACITY
+                                   : 2 * p_object->symbolCapacity;
+        HOB_symbol* newSymbols =
+            realloc(p_object->symbols, newCapacity * sizeof(HOB_symbol));
+        if (newSymbols == NULL) {
+            fprintf(stderr, "Could not grow the symbols of the object to %u\n",
+                    newCapacity);
+            exit(1);
+        }
+        p_object->symbols = newSymbols;
+        p_object->symbolCapacity = newCapacity;
+    }
+    p_object->symbols[p_object->symbolCount].name = *p_name;
+    p_object->symbols[p_object->symbolCount].value = value;
+    p_object->symbolCount++;
+}
+
+static void HOB_push_relocation(HackObject* p_object, uint32_t address,
+                                uint32_t symbol) {
+    if (p_object->relocationCount == p_object->relocationCapacity) {
+        uint32_t newCapacity = p_object->relocationCapacity == 0
+                                   ? HOB_INITIAL_CAPACITY
+                                   : 2 * p_object->relocationCapacity;
+        HOB_relocation* newRelocations = realloc(
+            p_object->relocations, newCapacity * sizeof(HOB_relocation));
+        if (newRelocations == NULL) {
+            fprintf(stderr,
+                    "Could not grow the relocations of the object to %u\n",
+                    newCapacity);
+            exit(1);
+        }
+        p_object->relocations = newRelocations;
+        p_object->relocationCapacity = newCapacity;
+    }
+    p_object->relocations[p_object->relocationCount].address = address;
+    p_object->relocations[p_object->relocationCount].symbol = symbol;
+    p_object->relocationCount++;
+}
+
+// Returns the index of the symbol named p_name, adding it as undefined
+// Returns -1 for a predefined symbol, whose value is written in p_value
+static int64_t HOB_symbol_index(HackObject* p_object, const HackSlice* p_name,
+                                uint32_t* p_value) {
+    int64_t value = ST_check_for_slice(&p_object->index, p_name);
+    if (value == KEY_NOT_FOUND) {
+        ST_add_slice(&p_object->index, p_name,
+                     HOB_FIRST_INDEX + p_object->symbolCount);
+        HOB_push_symbol(p_object, p_name, HOB_UNDEFINED);
+        return p_object->symbolCount - 1;
+    }
+    if (value < HOB_FIRST_INDEX) {
+        *p_value = value;
+        return -1;
+    }
+    return value - HOB_FIRST_INDEX;
+}
+
+void HOB_add_line(HackObject* p_object, const HackLine* p_line,
+                  HackDiagnostics* p_diag) {
+    HackInstructions* p_words = &p_object->words;
+    // Only the first definition of a label is kept, and the predefined
+    // symbols can't be redefined
+    if (p_line->type == HL_LABEL) {
+        if (p_line->symbol.length > 0) {
+            uint32_t value;
+            int64_t index = HOB_symbol_index(p_object, &p_line->symbol, &value);
+            if (index >= 0 && p_object->symbols[index].value == HOB_UNDEFINED) {
+                p_object->symbols[index].value = p_words->size;
+            }
+        }
+        return;
+    }
+
+    HackInstruction instruction = 0;
+    if (p_line->type == HL_A_INSTRUCTION) {
+        int32_t address;
+        uint32_t value;
+        if (HL_slice_to_number(&p_line->symbol, &address)) {
+            set_AInstruction(&instruction, address);
+        } else {
+            int64_t index = HOB_symbol_index(p_object, &p_line->symbol, &value);
+            if (index < 0) {
+                set_AInstruction(&instruction, value);
+            } else {
+                HOB_push_relocation(p_object, p_words->size, index);
+            }
+        }
+    } else if (!set_CInstruction(&instruction, &p_line->dest, &p_line->comp,
+                                 &p_line->jump)) {
+        HD_error(p_diag, p_line->lineNumber, "Unknown C instruction");
+    }
+    HI_push_back(p_words, instruction);
+}
+
+uint32_t source_to_object(const char* source, size_t length,
+                          HackObject* p_object, HackDiagnostics* p_diag) {
+    HackLexer lexer;
+    HL_init(&lexer, source, length);
+    HackLine line;
+    while (HL_next_line(&lexer, &line)) {
+        HOB_add_line(p_object, &line, p_diag);
+    }
+    return p_object->words.size;
+}
+
+static void HOB_write_u32(FILE* stream, uint32_t value) {
+    unsigned char bytes[4] = {value & 0xFF, (value >> 8) & 0xFF,
+                              (value >> 16) & 0xFF, value >> 24};
+    fwrite(bytes, 1, sizeof(bytes), stream);
+}
+
+bool HOB_write(HackObject* p_object, FILE* stream) {
+    fwrite(HOB_MAGIC, 1, HOB_MAGIC_LENGTH, stream);
+    HOB_write_u32(stream, p_object->words.size);
+    HOB_write_u32(stream, p_object->symbolCount);
+    HOB_write_u32(stream, p_object->relocationCount);
+    // Little-endian words, in a single write
+    if (p_object->words.size > 0 &&
+        !HI_write_binary(&p_object->words, stream, false)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < p_object->symbolCount; ++i) {
+        const HOB_symbol* p_symbol = p_object->symbols + i;
+        HOB_write_u32(stream, p_symbol->value);
+        HOB_write_u32(stream, p_symbol->name.length);
+        fwrite(p_symbol->name.start, 1, p_symbol->name.length, stream);
+    }
+    for (uint32_t i = 0; i < p_object->relocationCount; ++i) {
+        HOB_write_u32(stream, p_object->relocations[i].address);
+        HOB_write_u32(stream, p_object->relocations[i].symbol);
+    }
+    return !ferror(stream);
+}
+
+// Returns a pointer to the next size bytes of the reader, or NULL
+static const unsigned char* HOB_read_bytes(HOB_reader* p_reader, size_t size) {
+    if (!p_reader->valid || (size_t)(p_reader->end - p_reader->cursor) < size) {
+        p_reader->valid = false;
+        return NULL;
+    }
+    const unsigned char* data = p_reader->cursor;
+    p_reader->cursor += size;
+    return data;
+}
+
+static uint32_t HOB_read_u32(HOB_reader* p_reader) {
+    const unsigned char* bytes = HOB_read_bytes(p_reader, 4);
+    if (bytes == NULL) {
+        return 0;
+    }
+    return bytes[0] | (bytes[1] << 8) | ((uint32_t)bytes[2] << 16) |
+           ((uint32_t)bytes[3] << 24);
+}
+
+bool HOB_read(HackObject* p_object, const HackSource* p_file) {
+    HOB_reader reader = {(const unsigned char*)p_file->data,
+                         (const unsigned char*)p_file->data + p_file->length,
+                         true};
+    const unsigned char* magic = HOB_read_bytes(&reader, HOB_MAGIC_LENGTH);
+    if (magic == NULL || memcmp(magic, HOB_MAGIC, HOB_MAGIC_LENGTH) != 0) {
+        return false;
+    }
+    uint32_t wordCount = HOB_read_u32(&reader);
+    uint32_t symbolCount = HOB_read_u32(&reader);
+    uint32_t relocationCount = HOB_read_u32(&reader);
+    // Each word takes 2 bytes and each record 8, this bounds the allocations
+    size_t left = reader.end - reader.cursor;
+    if (!reader.valid || wordCount > left / 2 || symbolCount > left / 8 ||
+        relocationCount > left / 8) {
+        return false;
+    }
+    const unsigned char* words = HOB_read_bytes(&reader, (size_t)wordCount * 2);
+    HI_resize(&p_object->words, wordCount);
+    for (uint32_t i = 0; i < wordCount; ++i) {
+        p_object->words.words[i] = words[2 * i] | (words[2 * i + 1] << 8);
+    }
+    for (uint32_t i = 0; i < symbolCount && reader.valid; ++i) {
+        uint32_t value = HOB_read_u32(&reader);
+        HackSlice name;
+        name.length = HOB_read_u32(&reader);
+        name.start = (const char*)HOB_read_bytes(&reader, name.length);
+        if (value != HOB_UNDEFINED && value > wordCount) {
+            reader.valid = false;
+        }
+        HOB_push_symbol(p_object, &name, value);
+    }
+    for (uint32_t i = 0; i < relocationCount && reader.valid; ++i) {
+        uint32_t address = HOB_read_u32(&reader);
+        uint32_t symbol = HOB_read_u32(&reader);
+        if (address >= wordCount || symbol >= symbolCount) {
+            reader.valid = false;
+        }
+        HOB_push_relocation(p_object, address, symbol);
+    }
+    return reader.valid;
+}
+
+void HOB_delete_object(HackObject* p_object) {
+    HI_delete_all_instructions(&p_object->words);
+    free(p_object->symbols);
+    free(p_object->relocations);
+    p_object->symbols = NULL;
+    p_object->symbolCount = 0;
+    p_object->symbolCapacity = 0;
+    p_object->relocations = NULL;
+    p_object->relocationCount = 0;
+    p_object->relocationCapacity = 0;
+    ST_delete_all_entries(&p_object->index);
+}
@@ -0,0 +1,84 @@
+// Relocatable objects, written by HackAssembler --format=obj and merged by
+// HackLinker
+// An object holds the words of one source, with 0 in every A instruction
+// that references a symbol, the symbols of the source, and a relocation
+// for each of those words.
+// - A symbol defined by a label of the source is exported, its value is the
+//   address of the label in the object.
+// - A symbol that is only referenced is imported (HOB_UNDEFINED) : the
+//   linker resolves it to a label of another object, or else allocates it
+//   as a variable, in the order of first appearance in the linked program.
+// Numbers and predefined symbols (SP, R0, SCREEN...) are encoded in place.
+// So linking the objects of a.asm and b.asm gives the same words as
+// assembling a.asm and b.asm concatenated.
+//
+// File layout, all integers little-endian :
+//   "HACKOBJ1", u32 word count, u32 symbol count, u32 relocation count
+//   words, u16 each
+//   symbols, as (u32 value, u32 name length, name)
+//   relocations, as (u32 word address, u32 symbol index)
+#ifndef HACKOBJECT_H_
+#define HACKOBJECT_H_
+
+#define HOB_MAGIC "HACKOBJ1"
+#define HOB_MAGIC_LENGTH 8
+#define HOB_INITIAL_CAPACITY 256
+#define HOB_UNDEFINED 0xFFFFFFFF
+// Symbol indexes are stored in the table above the predefined values
+#define HOB_FIRST_INDEX 0x10000
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "HackDiagnostics.h"
+#include "HackInstructionList.h"
+#include "HackLexer.h"
+#include "HackSymbolTable.h"
+
+// Symbol of an object, name points into the source or the object file
+typedef struct HOB_symbol HOB_symbol;
+struct HOB_symbol {
+    HackSlice name;
+    // Address of the label in the object, or HOB_UNDEFINED
+    uint32_t value;
+};
+
+typedef struct HOB_relocation HOB_relocation;
+struct HOB_relocation {
+    uint32_t address;
+    uint32_t symbol;
+};
+
+typedef struct HackObject HackObject;
+struct HackObject {
+    HackInstructions words;
+    HOB_symbol* symbols;
+    uint32_t symbolCount;
+    uint32_t symbolCapacity;
+    HOB_relocation* relocations;
+    uint32_t relocationCount;
+    uint32_t relocationCapacity;
+    // Names of the symbols, and the predefined ones, while assembling
+    HackSymbolTable index;
+};
+
+void HOB_init(HackObject* p_object);
+// Encodes p_line at the end of p_object, as parser_add_line does
+void HOB_add_line(HackObject* p_object, const HackLine* p_line,
+                  HackDiagnostics* p_diag);
+// Assembles the whole source in p_object
+// Returns the count of words of the object
+uint32_t source_to_object(const char* source, size_t length,
+                          HackObject* p_object, HackDiagnostics* p_diag);
+// Returns false if the object could not be written
+bool HOB_write(HackObject* p_object, FILE* stream);
+// Reads the object file loaded in p_file into an empty p_object
+// The names point into p_file, which must outlive the object
+// Returns false if p_file is not a valid object
+bool HOB_read(HackObject* p_object, const HackSource* p_file);
+void HOB_delete_object(HackObject* p_object);
+
+#endif  // HACKOBJECT_H_
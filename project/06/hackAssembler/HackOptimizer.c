@@ -0,0 +1,682 @@
+#include "HackOptimizer.h"
+
+#include <string.h>
+
+#include "HackFixupList.h"
+#include "HackInstruction.h"
+#include "HackOutliner.h"
+#include "HackParser.h"
+#include "HackRules.h"
+
+// What a value number stands for
+typedef enum HO_kind {
+    // The number is the value itself
+    HO_CONSTANT,
+    // Address of a label, or of a variable
+    HO_LABEL,
+    HO_VARIABLE,
+    // Anything else : computed, or read from memory
+    HO_COMPUTED
+} HO_kind;
+
+typedef struct HO_value {
+    uint32_t id;
+    HO_kind kind;
+} HO_value;
+
+typedef struct HO_cell {
+    HO_value address;
+    HO_value content;
+} HO_cell;
+
+// What is known at some point of a block
+typedef struct HO_state {
+    HO_value a;
+    HO_value d;
+    HO_cell memory[HO_MEMORY_SLOTS];
+    uint32_t memorySize;
+} HO_state;
+
+typedef struct HO_context {
+    // Value number of every symbol, the predefined ones being constants
+    HackSymbolTable symbols;
+    uint32_t labelEnd;
+    uint32_t nextId;
+    HO_state state;
+} HO_context;
+
+void HO_init(HackProgram* p_program) {
+    p_program->lines = NULL;
+    p_program->size = 0;
+    p_program->capacity = 0;
+    STA_init(&p_program->names);
+}
+
+void HO_push_back(HackProgram* p_program, const HackLine* p_line) {
+    if (p_program->size == p_program->capacity) {
+        uint32_t newCapacity = p_program->capacity == 0
+                                   ? HO_INITIAL_CAPACITY
+                                   : 2 * p_program->capacity;
+        HackLine* newLines =
+            realloc(p_program->lines, newCapacity * sizeof(HackLine));
+        if (newLines == NULL) {
+            fprintf(stderr, "Could not grow the lines array to %u\n",
+                    newCapacity);
+            exit(1);
+        }
+        p_program->lines = newLines;
+        p_program->capacity = newCapacity;
+    }
+    p_program->lines[p_program->size++] = *p_line;
+}
+
+void HO_read(HackProgram* p_program, const char* source, size_t length) {
+    HackLexer lexer;
+    HL_init(&lexer, source, length);
+    HackLine line;
+    while (HL_next_line(&lexer, &line)) {
+        HO_push_back(p_program, &line);
+    }
+}
+
+void HO_delete_all_lines(HackProgram* p_program) {
+    free(p_program->lines);
+    STA_release(&p_program->names);
+    HO_init(p_program);
+}
+
+static HO_value HO_constant(uint16_t value) {
+    HO_value constant = {value, HO_CONSTANT};
+    return constant;
+}
+
+static HO_value HO_fresh(HO_context* p_context) {
+    HO_value fresh = {p_context->nextId++, HO_COMPUTED};
+    return fresh;
+}
+
+// Forgets everything, as at the start of a block
+static void HO_reset(HO_context* p_context) {
+    p_context->state.a = HO_fresh(p_context);
+    p_context->state.d = HO_fresh(p_context);
+    p_context->state.memorySize = 0;
+}
+
+static HO_value HO_symbol(HO_context* p_context, const HackSlice* name) {
+    int64_t id = ST_check_for_slice(&p_context->symbols, name);
+    if (id == KEY_NOT_FOUND) {
+        id = p_context->nextId++;
+        ST_add_slice(&p_context->symbols, name, id);
+    }
+    HO_value symbol = {id, HO_COMPUTED};
+    if (id < HO_FIRST_FRESH) {
+        symbol.kind = HO_CONSTANT;
+    } else if (id < p_context->labelEnd) {
+        symbol.kind = HO_LABEL;
+    } else {
+        symbol.kind = HO_VARIABLE;
+    }
+    return symbol;
+}
+
+// A cell can be cached if its address is known and it is plain RAM
+static bool HO_cacheable(HO_value address) {
+    return (address.kind == HO_CONSTANT && address.id < HO_VOLATILE_ADDRESS) ||
+           address.kind == HO_VARIABLE;
+}
+
+// Returns true if 2 different cacheable addresses may be the same cell
+// Variables are allocated from FIRST_VARIABLE_ADDRESS, and never share it
+static bool HO_may_alias(HO_value a, HO_value b) {
+    if (a.kind == b.kind) {
+        return false;
+    }
+    HO_value constant = a.kind == HO_CONSTANT ? a : b;
+    return constant.id >= FIRST_VARIABLE_ADDRESS;
+}
+
+static HO_cell* HO_find_cell(HO_state* p_state, HO_value address) {
+    for (uint32_t i = 0; i < p_state->memorySize; ++i) {
+        if (p_state->memory[i].address.id == address.id) {
+            return p_state->memory + i;
+        }
+    }
+    return NULL;
+}
+
+static void HO_add_cell(HO_state* p_state, HO_value address,
+                        HO_value content) {
+    if (p_state->memorySize == HO_MEMORY_SLOTS) {
+        // Forget the oldest cell
+        memmove(p_state->memory, p_state->memory + 1,
+                (HO_MEMORY_SLOTS - 1) * sizeof(HO_cell));
+        p_state->memorySize--;
+    }
+    p_state->memory[p_state->memorySize].address = address;
+    p_state->memory[p_state->memorySize].content = content;
+    p_state->memorySize++;
+}
+
+static HO_value HO_load(HO_context* p_context, HO_value address) {
+    if (!HO_cacheable(address)) {
+        return HO_fresh(p_context);
+    }
+    HO_cell* p_cell = HO_find_cell(&p_context->state, address);
+    if (p_cell != NULL) {
+        return p_cell->content;
+    }
+    // Unknown, but the same until the cell is written
+    HO_value content = HO_fresh(p_context);
+    HO_add_cell(&p_context->state, address, content);
+    return content;
+}
+
+static void HO_store(HO_context* p_context, HO_value address,
+                     HO_value content) {
+    HO_state* p_state = &p_context->state;
+    if (!HO_cacheable(address)) {
+        p_state->memorySize = 0;
+        return;
+    }
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < p_state->memorySize; ++i) {
+        HO_value cellAddress = p_state->memory[i].address;
+        if (cellAddress.id != address.id &&
+            !HO_may_alias(cellAddress, address)) {
+            p_state->memory[kept++] = p_state->memory[i];
+        }
+    }
+    p_state->memorySize = kept;
+    HO_add_cell(p_state, address, content);
+}
+
+// Value number of the ALU output for comp, x being D and y being A or M
+static HO_value HO_evaluate(HO_context* p_context, uint16_t comp, HO_value x,
+                            HO_value y) {
+    uint16_t alu = comp & 0x3F;
+    // zx and zy make the ALU ignore an input
+    bool xKnown = (alu & 0x20) || x.kind == HO_CONSTANT;
+    bool yKnown = (alu & 0x08) || y.kind == HO_CONSTANT;
+    if (xKnown && yKnown) {
+        return HO_constant(HI_alu(alu, x.id, y.id));
+    }
+    // D and A (or M) pass an input through
+    if (alu == 12) {
+        return x;
+    }
+    if (alu == 48) {
+        return y;
+    }
+    return HO_fresh(p_context);
+}
+
+// Returns true if the C instruction word is M=M+1 or M=M-1
+// The other one is returned in p_inverse
+static bool HO_is_increment(HackInstruction word, HackInstruction* p_inverse) {
+    const HackInstruction increment =
+        HI_C_PREFIX | (HI_COMP_M | 55) << HI_COMP_SHIFT |
+        HI_DEST_M << HI_DEST_SHIFT;
+    const HackInstruction decrement =
+        HI_C_PREFIX | (HI_COMP_M | 50) << HI_COMP_SHIFT |
+        HI_DEST_M << HI_DEST_SHIFT;
+    if (word == increment || word == decrement) {
+        *p_inverse = word == increment ? decrement : increment;
+        return true;
+    }
+    return false;
+}
+
+void HO_peephole(HackProgram* p_program, HO_stats* p_stats) {
+    HO_stats stats;
+    memset(&stats, 0, sizeof(HO_stats));
+    HO_context context;
+    ST_initialise(&context.symbols);
+    context.nextId = HO_FIRST_FRESH;
+    // Labels are numbered first, so that they can be told from variables
+    for (uint32_t i = 0; i < p_program->size; ++i) {
+        if (p_program->lines[i].type == HL_LABEL &&
+            p_program->lines[i].symbol.length > 0) {
+            HO_symbol(&context, &p_program->lines[i].symbol);
+        }
+    }
+    context.labelEnd = context.nextId;
+    HO_reset(&context);
+
+    // Last kept M=M+1 or M=M-1 that could still be cancelled
+    uint32_t pairIndex = UINT32_MAX;
+    HackInstruction pairInverse = 0;
+    HO_state pairState;
+
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < p_program->size; ++i) {
+        const HackLine* p_line = p_program->lines + i;
+        HO_state* p_state = &context.state;
+
+        if (p_line->type == HL_LABEL) {
+            HO_reset(&context);
+            pairIndex = UINT32_MAX;
+            p_program->lines[kept++] = *p_line;
+            continue;
+        }
+
+        if (p_line->type == HL_A_INSTRUCTION) {
+            int32_t number;
+            HO_value value = HL_slice_to_number(&p_line->symbol, &number)
+                                 ? HO_constant(number & 0x7FFF)
+                                 : HO_symbol(&context, &p_line->symbol);
+            if (value.id == p_state->a.id) {
+                stats.removedLoads++;
+                continue;
+            }
+            p_state->a = value;
+            pairIndex = UINT32_MAX;
+            p_program->lines[kept++] = *p_line;
+            continue;
+        }
+
+        HackInstruction word;
+        if (!set_CInstruction(&word, &p_line->dest, &p_line->comp,
+                              &p_line->jump)) {
+            // Reported when encoding, nothing is known after it
+            HO_reset(&context);
+            pairIndex = UINT32_MAX;
+            p_program->lines[kept++] = *p_line;
+            continue;
+        }
+
+        HackInstruction inverse;
+        if (pairIndex != UINT32_MAX && pairIndex == kept - 1 &&
+            word == pairInverse) {
+            // The cell is back to its value before the pair
+            *p_state = pairState;
+            kept--;
+            pairIndex = UINT32_MAX;
+            stats.cancelledPairs++;
+            continue;
+        }
+
+        uint16_t comp = HI_COMP(word);
+        uint16_t dest = HI_DEST(word);
+        HO_value y = (comp & HI_COMP_M) ? HO_load(&context, p_state->a)
+                                        : p_state->a;
+        HO_value result = HO_evaluate(&context, comp, p_state->d, y);
+
+        if (HI_JUMP(word) == 0) {
+            HO_cell* p_cell = HO_cacheable(p_state->a)
+                                  ? HO_find_cell(p_state, p_state->a)
+                                  : NULL;
+            bool redundant =
+                (!(dest & HI_DEST_A) || p_state->a.id == result.id) &&
+                (!(dest & HI_DEST_D) || p_state->d.id == result.id) &&
+                (!(dest & HI_DEST_M) ||
+                 (p_cell != NULL && p_cell->content.id == result.id));
+            if (redundant) {
+                stats.removedOperations++;
+                continue;
+            }
+        }
+
+        if (HO_is_increment(word, &inverse)) {
+            pairIndex = kept;
+            pairInverse = inverse;
+            pairState = *p_state;
+        } else {
+            pairIndex = UINT32_MAX;
+        }
+        // M is written at the address A had before the instruction
+        if (dest & HI_DEST_M) {
+            HO_store(&context, p_state->a, result);
+        }
+        if (dest & HI_DEST_A) {
+            p_state->a = result;
+        }
+        if (dest & HI_DEST_D) {
+            p_state->d = result;
+        }
+        p_program->lines[kept++] = *p_line;
+    }
+    p_program->size = kept;
+
+    ST_delete_all_entries(&context.symbols);
+    if (p_stats != NULL) {
+        p_stats->removedLoads = stats.removedLoads;
+        p_stats->removedOperations = stats.removedOperations;
+        p_stats->cancelledPairs = stats.cancelledPairs;
+    }
+}
+
+bool HO_always_jumps(HackInstruction word) {
+    uint16_t comp = HI_COMP(word);
+    uint16_t jump = HI_JUMP(word);
+    if (jump == (HI_JUMP_LT | HI_JUMP_EQ | HI_JUMP_GT)) {
+        return true;
+    }
+    // zx and zy : the ALU output is a constant
+    if ((comp & 0x20) && (comp & 0x08)) {
+        return HI_jumps(jump, HI_alu(comp, 0, 0));
+    }
+    return false;
+}
+
+uint32_t HO_find_absolute_jump(const HackProgram* p_program) {
+    bool numberInA = false;
+    for (uint32_t i = 0; i < p_program->size; ++i) {
+        const HackLine* p_line = p_program->lines + i;
+        if (p_line->type == HL_LABEL) {
+            numberInA = false;
+        } else if (p_line->type == HL_A_INSTRUCTION) {
+            int32_t number;
+            numberInA = HL_slice_to_number(&p_line->symbol, &number);
+        } else {
+            HackInstruction word;
+            set_CInstruction(&word, &p_line->dest, &p_line->comp,
+                             &p_line->jump);
+            if (numberInA && HI_JUMP(word) != 0) {
+                return p_line->lineNumber;
+            }
+            if (HI_DEST(word) & HI_DEST_A) {
+                numberInA = false;
+            }
+        }
+    }
+    return 0;
+}
+
+// Maps each label to the line of its first definition, plus HO_FIRST_FRESH
+// so that the predefined symbols are told apart
+static void HO_index_labels(const HackProgram* p_program,
+                            HackSymbolTable* p_labels) {
+    ST_initialise(p_labels);
+    for (uint32_t i = 0; i < p_program->size; ++i) {
+        const HackLine* p_line = p_program->lines + i;
+        if (p_line->type == HL_LABEL && p_line->symbol.length > 0 &&
+            ST_check_for_slice(p_labels, &p_line->symbol) == KEY_NOT_FOUND) {
+            ST_add_slice(p_labels, &p_line->symbol, HO_FIRST_FRESH + i);
+        }
+    }
+}
+
+// Returns the line of the label an A instruction loads, or -1
+static int64_t HO_label_line(HackSymbolTable* p_labels,
+                             const HackLine* p_line) {
+    if (p_line->type != HL_A_INSTRUCTION) {
+        return -1;
+    }
+    int64_t value = ST_check_for_slice(p_labels, &p_line->symbol);
+    return value == KEY_NOT_FOUND || value < HO_FIRST_FRESH
+               ? -1
+               : value - HO_FIRST_FRESH;
+}
+
+// Returns true if p_line is a jump without destination whose comp does not
+// read A or M, so that the value of A only matters as the target
+static bool HO_is_plain_jump(const HackLine* p_line, HackInstruction* p_word) {
+    if (p_line->type != HL_C_INSTRUCTION ||
+        !set_CInstruction(p_word, &p_line->dest, &p_line->comp,
+                          &p_line->jump)) {
+        return false;
+    }
+    // zy : the ALU ignores A and M
+    return HI_JUMP(*p_word) != 0 && HI_DEST(*p_word) == 0 &&
+           (HI_COMP(*p_word) & 0x08);
+}
+
+// Returns the line of the label where a jump to the label on labelLine
+// ends up. Each hop of a cycle is as good as the others, so HO_MAX_HOPS
+// is enough to stop on one.
+static uint32_t HO_final_target(const HackProgram* p_program,
+                                HackSymbolTable* p_labels,
+                                uint32_t labelLine) {
+    uint32_t target = labelLine;
+    for (int hop = 0; hop < HO_MAX_HOPS; ++hop) {
+        uint32_t i = target;
+        while (i < p_program->size && p_program->lines[i].type == HL_LABEL) {
+            i++;
+        }
+        HackInstruction word;
+        if (i + 1 >= p_program->size ||
+            !HO_is_plain_jump(p_program->lines + i + 1, &word) ||
+            !HO_always_jumps(word)) {
+            break;
+        }
+        int64_t next = HO_label_line(p_labels, p_program->lines + i);
+        if (next < 0) {
+            break;
+        }
+        target = next;
+    }
+    return target;
+}
+
+uint32_t HO_thread_jumps(HackProgram* p_program) {
+    HackSymbolTable labels;
+    HO_index_labels(p_program, &labels);
+    uint32_t threaded = 0;
+    for (uint32_t i = 0; i + 1 < p_program->size; ++i) {
+        int64_t labelLine = HO_label_line(&labels, p_program->lines + i);
+        HackInstruction word;
+        if (labelLine < 0 ||
+            !HO_is_plain_jump(p_program->lines + i + 1, &word)) {
+            continue;
+        }
+        // When the jump is not taken, A must not be read before a load
+        if (!HO_always_jumps(word) && i + 2 < p_program->size &&
+            p_program->lines[i + 2].type != HL_A_INSTRUCTION) {
+            continue;
+        }
+        uint32_t target = HO_final_target(p_program, &labels, labelLine);
+        if (target != labelLine) {
+            p_program->lines[i].symbol = p_program->lines[target].symbol;
+            threaded++;
+        }
+    }
+    ST_delete_all_entries(&labels);
+    return threaded;
+}
+
+uint32_t HO_remove_jumps_to_next(HackProgram* p_program) {
+    HackSymbolTable labels;
+    HO_index_labels(p_program, &labels);
+    uint32_t removed = 0;
+    uint32_t kept = 0;
+    uint32_t i = 0;
+    while (i < p_program->size) {
+        int64_t labelLine = HO_label_line(&labels, p_program->lines + i);
+        HackInstruction word;
+        if (labelLine >= 0 && i + 1 < p_program->size &&
+            HO_is_plain_jump(p_program->lines + i + 1, &word)) {
+            bool jumpsToNext = false;
+            uint32_t next = i + 2;
+            while (next < p_program->size &&
+                   p_program->lines[next].type == HL_LABEL) {
+                jumpsToNext = jumpsToNext || next == labelLine;
+                next++;
+            }
+            // Whether jumping or falling through, the code after the
+            // labels is reached, with A loaded again
+            if (jumpsToNext &&
+                (next == p_program->size ||
+                 p_program->lines[next].type == HL_A_INSTRUCTION)) {
+                i += 2;
+                removed += 2;
+                continue;
+            }
+        }
+        p_program->lines[kept++] = p_program->lines[i++];
+    }
+    p_program->size = kept;
+    ST_delete_all_entries(&labels);
+    return removed;
+}
+
+uint32_t HO_remove_unused_labels(HackProgram* p_program) {
+    HackSymbolTable referenced;
+    ST_initialise(&referenced);
+    for (uint32_t i = 0; i < p_program->size; ++i) {
+        const HackLine* p_line = p_program->lines + i;
+        int32_t number;
+        if (p_line->type == HL_A_INSTRUCTION &&
+            !HL_slice_to_number(&p_line->symbol, &number)) {
+            ST_add_slice(&referenced, &p_line->symbol, 0);
+        }
+    }
+    uint32_t removed = 0;
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < p_program->size; ++i) {
+        const HackLine* p_line = p_program->lines + i;
+        if (p_line->type == HL_LABEL &&
+            ST_check_for_slice(&referenced, &p_line->symbol) ==
+                KEY_NOT_FOUND) {
+            removed++;
+            continue;
+        }
+        p_program->lines[kept++] = *p_line;
+    }
+    p_program->size = kept;
+    ST_delete_all_entries(&referenced);
+    return removed;
+}
+
+uint32_t HO_remove_unreachable(HackProgram* p_program) {
+    if (p_program->size == 0) {
+        return 0;
+    }
+    // Blocks, as ranges of lines
+    uint32_t* blockStarts = malloc((p_program->size + 1) * sizeof(uint32_t));
+    bool* reachable = calloc(p_program->size + 1, sizeof(bool));
+    uint32_t* worklist = malloc((p_program->size + 1) * sizeof(uint32_t));
+    if (blockStarts == NULL || reachable == NULL || worklist == NULL) {
+        fprintf(stderr, "Could not allocate the blocks\n");
+        exit(1);
+    }
+    // Block of the first definition of each label, plus HO_FIRST_FRESH so
+    // that the predefined symbols are told apart
+    HackSymbolTable labels;
+    ST_initialise(&labels);
+    uint32_t blockCount = 0;
+    bool startsBlock = true;
+    for (uint32_t i = 0; i < p_program->size; ++i) {
+        const HackLine* p_line = p_program->lines + i;
+        if (p_line->type == HL_LABEL || startsBlock) {
+            blockStarts[blockCount++] = i;
+        }
+        startsBlock = false;
+        if (p_line->type == HL_LABEL) {
+            if (p_line->symbol.length > 0 &&
+                ST_check_for_slice(&labels, &p_line->symbol) ==
+                    KEY_NOT_FOUND) {
+                ST_add_slice(&labels, &p_line->symbol,
+                             HO_FIRST_FRESH + blockCount - 1);
+            }
+        } else if (p_line->type == HL_C_INSTRUCTION) {
+            HackInstruction word;
+            set_CInstruction(&word, &p_line->dest, &p_line->comp,
+                             &p_line->jump);
+            startsBlock = HI_JUMP(word) != 0;
+        }
+    }
+    blockStarts[blockCount] = p_program->size;
+
+    uint32_t pending = 0;
+    worklist[pending++] = 0;
+    reachable[0] = true;
+    while (pending > 0) {
+        uint32_t block = worklist[--pending];
+        bool fallsThrough = true;
+        for (uint32_t i = blockStarts[block]; i < blockStarts[block + 1];
+             ++i) {
+            const HackLine* p_line = p_program->lines + i;
+            int32_t number;
+            if (p_line->type == HL_A_INSTRUCTION &&
+                !HL_slice_to_number(&p_line->symbol, &number)) {
+                int64_t target = ST_check_for_slice(&labels, &p_line->symbol);
+                if (target != KEY_NOT_FOUND && target >= HO_FIRST_FRESH &&
+                    !reachable[target - HO_FIRST_FRESH]) {
+                    target -= HO_FIRST_FRESH;
+                    reachable[target] = true;
+                    worklist[pending++] = target;
+                }
+            } else if (p_line->type == HL_C_INSTRUCTION) {
+                HackInstruction word;
+                set_CInstruction(&word, &p_line->dest, &p_line->comp,
+                                 &p_line->jump);
+                fallsThrough = !HO_always_jumps(word);
+            }
+        }
+        if (fallsThrough && block + 1 < blockCount && !reachable[block + 1]) {
+            reachable[block + 1] = true;
+            worklist[pending++] = block + 1;
+        }
+    }
+
+    uint32_t removed = 0;
+    uint32_t kept = 0;
+    for (uint32_t block = 0; block < blockCount; ++block) {
+        for (uint32_t i = blockStarts[block]; i < blockStarts[block + 1];
+             ++i) {
+            if (reachable[block]) {
+                p_program->lines[kept++] = p_program->lines[i];
+            } else if (p_program->lines[i].type != HL_LABEL) {
+                removed++;
+            }
+        }
+    }
+    p_program->size = kept;
+
+    ST_delete_all_entries(&labels);
+    free(blockStarts);
+    free(reachable);
+    free(worklist);
+    return removed;
+}
+
+uint32_t source_to_machine_code_optimized(const char* source, size_t length,
+                                          HackInstructions* p_list,
+                                          HackSymbolTable* p_table,
+                                          const HackRules* p_rules,
+                                          uint32_t outlineLength,
+                                          HackDiagnostics* p_diag,
+                                          HO_stats* p_stats,
+                                          HackListing* p_listing) {
+    HackProgram program;
+    HO_init(&program);
+    HO_read(&program, source, length);
+    HO_stats stats;
+    memset(&stats, 0, sizeof(HO_stats));
+    stats.absoluteJumpLine = HO_find_absolute_jump(&program);
+    if (stats.absoluteJumpLine == 0) {
+        stats.threadedJumps = HO_thread_jumps(&program);
+        stats.unreachableWords = HO_remove_unreachable(&program);
+        stats.jumpToNextWords = HO_remove_jumps_to_next(&program);
+        stats.unusedLabels = HO_remove_unused_labels(&program);
+        HO_peephole(&program, &stats);
+        if (p_rules != NULL) {
+            stats.rewrittenWindows = HR_apply(p_rules, &program);
+        }
+        if (outlineLength > 0) {
+            HOL_stats outlined;
+            HOL_outline(&program, outlineLength, &outlined);
+            stats.outlinedSequences = outlined.subroutines;
+            stats.outlinedCalls = outlined.calls;
+            stats.outlinedWords = outlined.savedWords;
+            stats.outlineSkipped = outlined.noFinalJump;
+        }
+    }
+    if (p_stats != NULL) {
+        *p_stats = stats;
+    }
+
+    uint32_t firstAddress = p_list->size;
+    HackFixups fixups;
+    HF_init(&fixups);
+    for (uint32_t i = 0; i < program.size; ++i) {
+        parser_add_line(program.lines + i, p_list, p_table, &fixups, p_diag);
+        if (p_listing != NULL) {
+            HLS_add_line(p_listing, program.lines + i);
+        }
+    }
+    parser_resolve_fixups(&fixups, p_list, p_table);
+    HF_delete_all_fixups(&fixups);
+    HO_delete_all_lines(&program);
+    return p_list->size - firstAddress;
+}
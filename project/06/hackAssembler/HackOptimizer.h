@@ -0,0 +1,138 @@
+// Optimizer, enabled with -O
+// The source is first read in an array of lines. The jumps are threaded,
+// the blocks that can't be reached are removed, then the jumps to the next
+// instruction and the labels that are not referenced anymore.
+// Then the peephole pass runs : in each basic block
+// (a block starts at every label, and falls through conditional jumps), the
+// optimizer tracks what is known of A, D and a few memory cells, as value
+// numbers : 2 registers hold the same number only if they provably hold the
+// same value. An instruction that would not change the state is dropped :
+// - an A instruction loading the value already in A (@SP after @SP),
+// - a C instruction whose destinations already hold its result
+//   (D=M after D=M, M=D after D=M on the same cell),
+// - an M=M+1 directly followed by M=M-1 on the same cell, or the opposite.
+// The remaining lines are then encoded as usual, so the labels get the
+// addresses of the optimized program.
+//
+// Reads through pointers and from KBD are never assumed to give the same
+// value twice, and a write through a pointer forgets every memory cell, so
+// the pass does not rely on the VM memory conventions.
+// Jumps must target labels : a jump to a numeric address would land on a
+// moved instruction. A source with a jump right after an @number (the
+// output of some compilers) is therefore assembled without optimization.
+#ifndef HACKOPTIMIZER_H_
+#define HACKOPTIMIZER_H_
+
+// Memory cells tracked at once in a block
+#define HO_MEMORY_SLOTS 16
+// Value numbers below are 16-bit constants
+#define HO_FIRST_FRESH 0x10000
+// Reads from this address and above are never cached
+#define HO_VOLATILE_ADDRESS 24576
+#define HO_INITIAL_CAPACITY 1024
+// Jumps followed at most when threading a chain of jumps
+#define HO_MAX_HOPS 16
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "HackDiagnostics.h"
+#include "HackInstructionList.h"
+#include "HackLexer.h"
+#include "HackListing.h"
+#include "HackSymbolTable.h"
+
+// Growable array of the lines of a source
+typedef struct HackProgram HackProgram;
+struct HackProgram {
+    HackLine* lines;
+    uint32_t size;
+    uint32_t capacity;
+    // Names of the labels that passes add, the other slices point into the
+    // source
+    ST_arena names;
+};
+
+typedef struct HO_stats {
+    uint32_t removedLoads;
+    uint32_t removedOperations;
+    uint32_t cancelledPairs;
+    // Windows rewritten by the rules of HackRules
+    uint32_t rewrittenWindows;
+    // Jumps redirected to the end of a chain of jumps
+    uint32_t threadedJumps;
+    // Instructions of the blocks that can't be reached
+    uint32_t unreachableWords;
+    // Instructions of the jumps to the next instruction
+    uint32_t jumpToNextWords;
+    uint32_t unusedLabels;
+    // Sequences outlined by HackOutliner, their calls, and the words saved
+    uint32_t outlinedSequences;
+    uint32_t outlinedCalls;
+    uint32_t outlinedWords;
+    // true if HackOutliner did nothing, the program not ending with an
+    // unconditional jump
+    bool outlineSkipped;
+    // Line of the first jump to a numeric address, 0 if none. The program
+    // was not optimized if it is set
+    uint32_t absoluteJumpLine;
+} HO_stats;
+
+typedef struct HackRules HackRules;
+
+void HO_init(HackProgram* p_program);
+void HO_push_back(HackProgram* p_program, const HackLine* p_line);
+// Appends every line of source to p_program
+void HO_read(HackProgram* p_program, const char* source, size_t length);
+void HO_delete_all_lines(HackProgram* p_program);
+
+// Returns true if the C instruction word always jumps
+bool HO_always_jumps(HackInstruction word);
+
+// Returns the line number of the first jump whose target is an @number,
+// or 0 if all jumps target symbols
+uint32_t HO_find_absolute_jump(const HackProgram* p_program);
+
+// Redirects the jumps to a label whose code is an unconditional jump
+// (@X / 0;JMP) to the end of the chain. Only the jumps without destination
+// that don't read A or M are redirected, and only if A is loaded again
+// before being read, since it then holds another label.
+// Returns the number of redirected jumps
+uint32_t HO_thread_jumps(HackProgram* p_program);
+
+// Removes the @L / jump pairs directly followed by (L), when A is loaded
+// again after (L). Returns the number of removed instructions
+uint32_t HO_remove_jumps_to_next(HackProgram* p_program);
+
+// Removes the labels that no A instruction references
+// Returns the number of removed labels
+uint32_t HO_remove_unused_labels(HackProgram* p_program);
+
+// Removes the blocks of p_program that can't be reached from its first
+// instruction. A block starts at a label and after a jump. A reachable
+// block reaches the next one unless it ends with a jump that is always
+// taken, and every label loaded by one of its A instructions, since the
+// address of a label in A is how jumps, and calls through a pushed return
+// address, find their target.
+// Returns the number of instructions removed
+uint32_t HO_remove_unreachable(HackProgram* p_program);
+
+// Removes the redundant instructions of p_program
+// Only the peephole counts of p_stats are set. p_stats may be NULL
+void HO_peephole(HackProgram* p_program, HO_stats* p_stats);
+
+// Same as source_to_machine_code, with HO_peephole, then the rewrite rules
+// of p_rules, then HOL_outline if outlineLength is not 0, run before the
+// encoding
+// The encoded lines are recorded in p_listing
+// p_rules, p_stats, p_diag and p_listing may be NULL
+uint32_t source_to_machine_code_optimized(const char* source, size_t length,
+                                          HackInstructions* p_list,
+                                          HackSymbolTable* p_table,
+                                          const HackRules* p_rules,
+                                          uint32_t outlineLength,
+                                          HackDiagnostics* p_diag,
+                                          HO_stats* p_stats,
+                                          HackListing* p_listing);
+
+#endif  // HACKOPTIMIZER_H_
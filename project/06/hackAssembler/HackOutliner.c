@@ -0,0 +1,520 @@
+#include "HackOutliner.h"
+
+#include <string.h>
+
+#include "HackInstruction.h"
+
+// Ids of the lines, equal ids meaning equal instructions :
+// - a C instruction is its word,
+// - an A instruction is HOL_A_IDS plus its number, or plus the value of a
+//   predefined symbol, or plus a new number above HO_FIRST_FRESH per symbol,
+// - a label, a jump or an invalid line is unique, so that no repeated
+//   sequence holds one.
+#define HOL_A_IDS 0x20000
+#define HOL_UNIQUE_IDS 0x80000000
+// "HO$outline.4294967295$ret.4294967295"
+#define HOL_NAME_SIZE 48
+
+typedef struct HOL_candidate {
+    // Range of the suffix array holding the occurrences
+    uint32_t lb;
+    uint32_t rb;
+    uint32_t length;
+    uint32_t saving;
+} HOL_candidate;
+
+typedef struct HOL_candidates {
+    HOL_candidate* candidates;
+    uint32_t size;
+    uint32_t capacity;
+} HOL_candidates;
+
+// Sort keys of the suffixes, for the comparison function of qsort
+static const uint64_t* sortKeys;
+
+static int HOL_compare_suffixes(const void* p_a, const void* p_b) {
+    uint64_t a = sortKeys[*(const uint32_t*)p_a];
+    uint64_t b = sortKeys[*(const uint32_t*)p_b];
+    return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+static int HOL_compare_positions(const void* p_a, const void* p_b) {
+    uint32_t a = *(const uint32_t*)p_a;
+    uint32_t b = *(const uint32_t*)p_b;
+    return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+static int HOL_compare_candidates(const void* p_a, const void* p_b) {
+    uint32_t a = ((const HOL_candidate*)p_a)->saving;
+    uint32_t b = ((const HOL_candidate*)p_b)->saving;
+    return a > b ? -1 : (a < b ? 1 : 0);
+}
+
+static void* HOL_allocate(size_t count, size_t size) {
+    void* memory = malloc((count + 1) * size);
+    if (memory == NULL) {
+        fprintf(stderr, "Could not allocate the outliner arrays\n");
+        exit(1);
+    }
+    return memory;
+}
+
+static bool HOL_is_a(const HackProgram* p_program, uint32_t i) {
+    return i < p_program->size &&
+           p_program->lines[i].type == HL_A_INSTRUCTION;
+}
+
+// Returns the scratch register the calls may use, HOL_SCRATCH if none
+static const char* HOL_find_scratch(const HackProgram* p_program) {
+    static const char* const registers[] = {"R15", "R14", "R13"};
+    bool used[3] = {false, false, false};
+    for (uint32_t i = 0; i < p_program->size; ++i) {
+        const HackLine* p_line = p_program->lines + i;
+        if (p_line->type != HL_A_INSTRUCTION) {
+            continue;
+        }
+        int32_t number = -1;
+        if (p_line->symbol.length == 3 && p_line->symbol.start[0] == 'R') {
+            HackSlice digits = {p_line->symbol.start + 1, 2};
+            HL_slice_to_number(&digits, &number);
+        } else if (HL_slice_to_number(&p_line->symbol, &number)) {
+            // A number is only an address if M is used right after
+            HackInstruction word;
+            const HackLine* p_next = p_line + 1;
+            if (i + 1 >= p_program->size ||
+                p_next->type != HL_C_INSTRUCTION ||
+                !set_CInstruction(&word, &p_next->dest, &p_next->comp,
+                                  &p_next->jump) ||
+                !((HI_COMP(word) & HI_COMP_M) ||
+                  (HI_DEST(word) & HI_DEST_M))) {
+                number = -1;
+            }
+        }
+        if (number >= 13 && number <= 15) {
+            used[15 - number] = true;
+        }
+    }
+    for (int r = 0; r < 3; ++r) {
+        if (!used[r]) {
+            return registers[r];
+        }
+    }
+    return HOL_SCRATCH;
+}
+
+// Fills ids with the id of every line
+static void HOL_line_ids(const HackProgram* p_program, uint32_t* ids) {
+    HackSymbolTable symbols;
+    ST_initialise(&symbols);
+    uint32_t nextSymbol = HO_FIRST_FRESH;
+    for (uint32_t i = 0; i < p_program->size; ++i) {
+        const HackLine* p_line = p_program->lines + i;
+        ids[i] = HOL_UNIQUE_IDS + i;
+        if (p_line->type == HL_A_INSTRUCTION) {
+            int32_t number;
+            if (HL_slice_to_number(&p_line->symbol, &number)) {
+                ids[i] = HOL_A_IDS + (number & 0x7FFF);
+                continue;
+            }
+            int64_t value = ST_check_for_slice(&symbols, &p_line->symbol);
+            if (value == KEY_NOT_FOUND) {
+                value = nextSymbol++;
+                ST_add_slice(&symbols, &p_line->symbol, value);
+            }
+            ids[i] = HOL_A_IDS + value;
+        } else if (p_line->type == HL_C_INSTRUCTION) {
+            HackInstruction word;
+            if (set_CInstruction(&word, &p_line->dest, &p_line->comp,
+                                 &p_line->jump) &&
+                HI_JUMP(word) == 0) {
+                ids[i] = word;
+            }
+        }
+    }
+    ST_delete_all_entries(&symbols);
+}
+
+// Sorts the suffixes of ids in sa by prefix doubling : after the round of
+// step k, the suffixes are sorted on their first 2k ids
+static void HOL_suffix_array(const uint32_t* ids, uint32_t n, uint32_t* sa) {
+    uint32_t* rank = HOL_allocate(n, sizeof(uint32_t));
+    uint64_t* keys = HOL_allocate(n, sizeof(uint64_t));
+    for (uint32_t i = 0; i < n; ++i) {
+        sa[i] = i;
+        rank[i] = ids[i];
+    }
+    sortKeys = keys;
+    for (uint32_t k = 1; n > 0; k *= 2) {
+        for (uint32_t i = 0; i < n; ++i) {
+            uint64_t next = i + k < n ? (uint64_t)rank[i + k] + 1 : 0;
+            keys[i] = (uint64_t)rank[i] << 32 | next;
+        }
+        qsort(sa, n, sizeof(uint32_t), HOL_compare_suffixes);
+        rank[sa[0]] = 0;
+        for (uint32_t j = 1; j < n; ++j) {
+            rank[sa[j]] = rank[sa[j - 1]] + (keys[sa[j]] != keys[sa[j - 1]]);
+        }
+        if (rank[sa[n - 1]] == n - 1 || k >= n) {
+            break;
+        }
+    }
+    sortKeys = NULL;
+    free(keys);
+    free(rank);
+}
+
+// Fills lcp[i] with the length of the common prefix of the suffixes sa[i-1]
+// and sa[i] (Kasai's algorithm)
+static void HOL_lcp(const uint32_t* ids, uint32_t n, const uint32_t* sa,
+                    uint32_t* lcp) {
+    uint32_t* rank = HOL_allocate(n, sizeof(uint32_t));
+    for (uint32_t i = 0; i < n; ++i) {
+        rank[sa[i]] = i;
+    }
+    uint32_t h = 0;
+    lcp[0] = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        if (rank[i] == 0) {
+            h = 0;
+            continue;
+        }
+        uint32_t j = sa[rank[i] - 1];
+        while (i + h < n && j + h < n && ids[i + h] == ids[j + h]) {
+            h++;
+        }
+        lcp[rank[i]] = h;
+        if (h > 0) {
+            h--;
+        }
+    }
+    free(rank);
+}
+
+// Returns the shortest length of the sequence at start that writes D before
+// reading it, or 0 if it reads D first
+static uint32_t HOL_d_written(const HackProgram* p_program, uint32_t start,
+                              uint32_t maxLength) {
+    for (uint32_t i = 0; i < maxLength; ++i) {
+        const HackLine* p_line = p_program->lines + start + i;
+        HackInstruction word;
+        if (p_line->type != HL_C_INSTRUCTION ||
+            !set_CInstruction(&word, &p_line->dest, &p_line->comp,
+                              &p_line->jump)) {
+            continue;
+        }
+        // zx : the ALU ignores D
+        if (!(HI_COMP(word) & 0x20)) {
+            return 0;
+        }
+        if (HI_DEST(word) & HI_DEST_D) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+// Counts the occurrences of length at the sorted positions that can be
+// replaced together : not overlapping each other or the used lines, and
+// followed by an A instruction
+static uint32_t HOL_count(const HackProgram* p_program,
+                          const uint32_t* positions, uint32_t count,
+                          uint32_t length, const bool* used) {
+    uint32_t kept = 0;
+    uint32_t nextFree = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t p = positions[i];
+        if (p < nextFree || !HOL_is_a(p_program, p + length)) {
+            continue;
+        }
+        bool free = true;
+        for (uint32_t j = p; used != NULL && free && j < p + length; ++j) {
+            free = !used[j];
+        }
+        if (free) {
+            kept++;
+            nextFree = p + length;
+        }
+    }
+    return kept;
+}
+
+static uint32_t HOL_saving(uint32_t count, uint32_t length) {
+    int64_t saving = (int64_t)count * (length - HOL_CALL_WORDS) - length -
+                     HOL_SUBROUTINE_WORDS;
+    return count >= 2 && saving > 0 ? (uint32_t)saving : 0;
+}
+
+static void HOL_push_candidate(HOL_candidates* p_candidates,
+                               HOL_candidate candidate) {
+    if (p_candidates->size == p_candidates->capacity) {
+        p_candidates->capacity =
+            p_candidates->capacity == 0 ? 256 : 2 * p_candidates->capacity;
+        HOL_candidate* newCandidates =
+            realloc(p_candidates->candidates,
+                    p_candidates->capacity * sizeof(HOL_candidate));
+        if (newCandidates == NULL) {
+            fprintf(stderr, "Could not grow the outlining candidates\n");
+            exit(1);
+        }
+        p_candidates->candidates = newCandidates;
+    }
+    p_candidates->candidates[p_candidates->size++] = candidate;
+}
+
+// Keeps the best length of the repeat [lb, rb] of the suffix array, whose
+// suffixes share lcp ids, and parentLcp with the enclosing repeat : the
+// lengths up to parentLcp are the enclosing repeat's
+static void HOL_evaluate(const HackProgram* p_program, const uint32_t* sa,
+                         uint32_t lb, uint32_t rb, uint32_t lcp,
+                         uint32_t parentLcp, uint32_t minLength,
+                         uint32_t* positions, HOL_candidates* p_candidates) {
+    uint32_t start = sa[lb];
+    if (lcp < minLength || !HOL_is_a(p_program, start)) {
+        return;
+    }
+    uint32_t written = HOL_d_written(p_program, start, lcp);
+    if (written == 0) {
+        return;
+    }
+    uint32_t shortest = parentLcp + 1;
+    shortest = shortest > minLength ? shortest : minLength;
+    shortest = shortest > written ? shortest : written;
+    if (shortest > lcp) {
+        return;
+    }
+    uint32_t count = rb - lb + 1;
+    memcpy(positions, sa + lb, count * sizeof(uint32_t));
+    qsort(positions, count, sizeof(uint32_t), HOL_compare_positions);
+    HOL_candidate best = {lb, rb, 0, 0};
+    for (uint32_t length = shortest; length <= lcp; ++length) {
+        uint32_t saving = HOL_saving(
+            HOL_count(p_program, positions, count, length, NULL), length);
+        if (saving > best.saving) {
+            best.length = length;
+            best.saving = saving;
+        }
+    }
+    if (best.saving > 0) {
+        HOL_push_candidate(p_candidates, best);
+    }
+}
+
+// Finds the repeats of the program as the intervals of the suffix array
+// whose suffixes share a prefix (bottom-up traversal of the LCP array)
+static void HOL_find_candidates(const HackProgram* p_program,
+                                const uint32_t* sa, const uint32_t* lcp,
+                                uint32_t minLength,
+                                HOL_candidates* p_candidates) {
+    uint32_t n = p_program->size;
+    uint32_t* stackLcp = HOL_allocate(n + 1, sizeof(uint32_t));
+    uint32_t* stackLb = HOL_allocate(n + 1, sizeof(uint32_t));
+    uint32_t* positions = HOL_allocate(n, sizeof(uint32_t));
+    uint32_t top = 0;
+    stackLcp[0] = 0;
+    stackLb[0] = 0;
+    for (uint32_t i = 1; i <= n; ++i) {
+        uint32_t current = i < n ? lcp[i] : 0;
+        uint32_t lb = i - 1;
+        while (stackLcp[top] > current) {
+            uint32_t parent =
+                stackLcp[top - 1] > current ? stackLcp[top - 1] : current;
+            HOL_evaluate(p_program, sa, stackLb[top], i - 1, stackLcp[top],
+                         parent, minLength, positions, p_candidates);
+            lb = stackLb[top];
+            top--;
+        }
+        if (stackLcp[top] < current) {
+            top++;
+            stackLcp[top] = current;
+            stackLb[top] = lb;
+        }
+    }
+    free(positions);
+    free(stackLb);
+    free(stackLcp);
+}
+
+static HackSlice HOL_name(HackProgram* p_program, const char* format,
+                          uint32_t subroutine, uint32_t call) {
+    char name[HOL_NAME_SIZE];
+    int length = snprintf(name, sizeof(name), format, subroutine, call);
+    HackSlice slice = {STA_intern(&p_program->names, name, length),
+                       (size_t)length};
+    return slice;
+}
+
+static HackLine HOL_line(HackLineType type, const char* symbol,
+                         const char* dest, const char* comp,
+                         const char* jump, uint32_t lineNumber) {
+    HackLine line;
+    line.type = type;
+    line.symbol.start = symbol;
+    line.symbol.length = strlen(symbol);
+    line.dest.start = dest;
+    line.dest.length = strlen(dest);
+    line.comp.start = comp;
+    line.comp.length = strlen(comp);
+    line.jump.start = jump;
+    line.jump.length = strlen(jump);
+    line.lineNumber = lineNumber;
+    return line;
+}
+
+void HOL_outline(HackProgram* p_program, uint32_t minLength,
+                 HOL_stats* p_stats) {
+    HOL_stats stats = {0, 0, 0, false};
+    uint32_t n = p_program->size;
+    const char* scratch = HOL_find_scratch(p_program);
+    HackInstruction last;
+    if (minLength < HOL_MIN_LENGTH) {
+        minLength = HOL_MIN_LENGTH;
+    }
+    if (n == 0 || p_program->lines[n - 1].type != HL_C_INSTRUCTION ||
+        !set_CInstruction(&last, &p_program->lines[n - 1].dest,
+                          &p_program->lines[n - 1].comp,
+                          &p_program->lines[n - 1].jump) ||
+        !HO_always_jumps(last)) {
+        stats.noFinalJump = true;
+        if (p_stats != NULL) {
+            *p_stats = stats;
+        }
+        return;
+    }
+
+    uint32_t* ids = HOL_allocate(n, sizeof(uint32_t));
+    uint32_t* sa = HOL_allocate(n, sizeof(uint32_t));
+    uint32_t* lcp = HOL_allocate(n, sizeof(uint32_t));
+    HOL_line_ids(p_program, ids);
+    HOL_suffix_array(ids, n, sa);
+    HOL_lcp(ids, n, sa, lcp);
+    HOL_candidates candidates = {NULL, 0, 0};
+    HOL_find_candidates(p_program, sa, lcp, minLength, &candidates);
+    if (candidates.size > 0) {
+        qsort(candidates.candidates, candidates.size, sizeof(HOL_candidate),
+              HOL_compare_candidates);
+    }
+
+    // The best candidates first, each one taking the occurrences that
+    // the previous ones left
+    bool* used = calloc(n + 1, sizeof(bool));
+    // Subroutine + 1 of the occurrence starting at each line, or 0
+    uint32_t* calls = calloc(n + 1, sizeof(uint32_t));
+    uint32_t* positions = HOL_allocate(n, sizeof(uint32_t));
+    HOL_candidate* chosen = HOL_allocate(candidates.size, sizeof(HOL_candidate));
+    if (used == NULL || calls == NULL) {
+        fprintf(stderr, "Could not allocate the outliner arrays\n");
+        exit(1);
+    }
+    for (uint32_t c = 0; c < candidates.size; ++c) {
+        HOL_candidate candidate = candidates.candidates[c];
+        uint32_t count = candidate.rb - candidate.lb + 1;
+        memcpy(positions, sa + candidate.lb, count * sizeof(uint32_t));
+        qsort(positions, count, sizeof(uint32_t), HOL_compare_positions);
+        uint32_t kept = HOL_count(p_program, positions, count,
+                                  candidate.length, used);
+        uint32_t saving = HOL_saving(kept, candidate.length);
+        if (saving == 0) {
+            continue;
+        }
+        // Same walk as HOL_count, marking the occurrences
+        uint32_t nextFree = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            uint32_t p = positions[i];
+            if (p < nextFree || !HOL_is_a(p_program, p + candidate.length)) {
+                continue;
+            }
+            bool free = true;
+            for (uint32_t j = p; free && j < p + candidate.length; ++j) {
+                free = !used[j];
+            }
+            if (!free) {
+                continue;
+            }
+            for (uint32_t j = p; j < p + candidate.length; ++j) {
+                used[j] = true;
+            }
+            calls[p] = stats.subroutines + 1;
+            nextFree = p + candidate.length;
+        }
+        // The body of the subroutine is copied from an occurrence
+        candidate.lb = positions[0];
+        chosen[stats.subroutines++] = candidate;
+        stats.calls += kept;
+        stats.savedWords += saving;
+    }
+
+    if (stats.subroutines > 0) {
+        HackProgram outlined;
+        HO_init(&outlined);
+        uint32_t* callCounts = calloc(stats.subroutines, sizeof(uint32_t));
+        if (callCounts == NULL) {
+            fprintf(stderr, "Could not allocate the outliner arrays\n");
+            exit(1);
+        }
+        for (uint32_t i = 0; i < n;) {
+            if (calls[i] == 0) {
+                HO_push_back(&outlined, p_program->lines + i);
+                i++;
+                continue;
+            }
+            uint32_t s = calls[i] - 1;
+            uint32_t lineNumber = p_program->lines[i].lineNumber;
+            HackSlice ret = HOL_name(p_program, "HO$outline.%u$ret.%u", s,
+                                     callCounts[s]++);
+            HackSlice sub = HOL_name(p_program, "HO$outline.%u", s, 0);
+            HackLine line =
+                HOL_line(HL_A_INSTRUCTION, "", "", "", "", lineNumber);
+            line.symbol = ret;
+            HO_push_back(&outlined, &line);
+            line = HOL_line(HL_C_INSTRUCTION, "", "D", "A", "", lineNumber);
+            HO_push_back(&outlined, &line);
+            line = HOL_line(HL_A_INSTRUCTION, "", "", "", "", lineNumber);
+            line.symbol = sub;
+            HO_push_back(&outlined, &line);
+            line = HOL_line(HL_C_INSTRUCTION, "", "", "0", "JMP", lineNumber);
+            HO_push_back(&outlined, &line);
+            line = HOL_line(HL_LABEL, "", "", "", "", lineNumber);
+            line.symbol = ret;
+            HO_push_back(&outlined, &line);
+            i += chosen[s].length;
+        }
+        for (uint32_t s = 0; s < stats.subroutines; ++s) {
+            const HackLine* body = p_program->lines + chosen[s].lb;
+            uint32_t lineNumber = body->lineNumber;
+            HackLine line = HOL_line(HL_LABEL, "", "", "", "", lineNumber);
+            line.symbol = HOL_name(p_program, "HO$outline.%u", s, 0);
+            HO_push_back(&outlined, &line);
+            line = HOL_line(HL_A_INSTRUCTION, scratch, "", "", "", lineNumber);
+            HO_push_back(&outlined, &line);
+            line = HOL_line(HL_C_INSTRUCTION, "", "M", "D", "", lineNumber);
+            HO_push_back(&outlined, &line);
+            for (uint32_t j = 0; j < chosen[s].length; ++j) {
+                HO_push_back(&outlined, body + j);
+            }
+            line = HOL_line(HL_A_INSTRUCTION, scratch, "", "", "", lineNumber);
+            HO_push_back(&outlined, &line);
+            line = HOL_line(HL_C_INSTRUCTION, "", "A", "M", "", lineNumber);
+            HO_push_back(&outlined, &line);
+            line = HOL_line(HL_C_INSTRUCTION, "", "", "0", "JMP", lineNumber);
+            HO_push_back(&outlined, &line);
+        }
+        // The names stay in p_program, only the lines are swapped
+        free(p_program->lines);
+        p_program->lines = outlined.lines;
+        p_program->size = outlined.size;
+        p_program->capacity = outlined.capacity;
+        free(callCounts);
+    }
+
+    free(chosen);
+    free(positions);
+    free(calls);
+    free(used);
+    free(candidates.candidates);
+    free(lcp);
+    free(sa);
+    free(ids);
+    if (p_stats != NULL) {
+        *p_stats = stats;
+    }
+}
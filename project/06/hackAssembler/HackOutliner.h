@@ -0,0 +1,59 @@
+// Outlining of repeated instruction sequences, run at the end of -O when
+// --outline=N is given
+// A suffix array of the program finds the sequences of at least N
+// instructions that appear several times. Each chosen sequence is moved to
+// a subroutine appended to the program, and every occurrence becomes a
+// call :
+//   @ret / D=A / @sub / 0;JMP / (ret)
+// The subroutine saves the return address in a scratch register, runs the
+// sequence, and jumps back :
+//   (sub) / @R15 / M=D / sequence / @R15 / A=M / 0;JMP
+// A call costs 4 words and 9 cycles, so a sequence of length L found k
+// times saves k * (L - 4) - L - 5 words. N is the size/speed knob : longer
+// sequences save fewer words, but are called less often for the same work.
+//
+// Since the call clobbers A and D, a sequence is only outlined if :
+// - it starts with an A instruction, and is followed by one,
+// - it writes D before reading it,
+// - it holds no label and no jump.
+// The scratch register is the first of R15, R14 and R13 that the program
+// never names and never addresses right after loading its number. If all
+// three are used (as with VMTranslator --shared), it is the HOL_SCRATCH
+// variable instead : it first appears in the subroutines, after every other
+// symbol, so it takes the next free variable address and moves none of the
+// others. The program must also end with an unconditional jump, so that it
+// can't run into the subroutines.
+#ifndef HACKOUTLINER_H_
+#define HACKOUTLINER_H_
+
+// Shortest sequence worth a call
+#define HOL_MIN_LENGTH 5
+// Words of a call, and of the entry and exit of a subroutine
+#define HOL_CALL_WORDS 4
+#define HOL_SUBROUTINE_WORDS 5
+// Variable holding the return address when R13 to R15 are all used
+#define HOL_SCRATCH "HO$outline.ret"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "HackOptimizer.h"
+
+typedef struct HOL_stats {
+    // Sequences moved to a subroutine, and the calls that replaced them
+    uint32_t subroutines;
+    uint32_t calls;
+    // Words saved, the cost of the calls and subroutines included
+    uint32_t savedWords;
+    // true if nothing was tried since the program does not end with an
+    // unconditional jump
+    bool noFinalJump;
+} HOL_stats;
+
+// Outlines the sequences of at least minLength instructions of p_program
+// (HOL_MIN_LENGTH if smaller). The new labels are interned in the names of
+// p_program. p_stats may be NULL
+void HOL_outline(HackProgram* p_program, uint32_t minLength,
+                 HOL_stats* p_stats);
+
+#endif  // HACKOUTLINER_H_
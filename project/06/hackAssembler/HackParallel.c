@@ -0,0 +1,215 @@
+#include "HackParallel.h"
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "HackFixupList.h"
+#include "HackLexer.h"
+#include "HackParser.h"
+
+// Label found in a chunk, at an address relative to the chunk
+typedef struct HP_label {
+    HackSlice name;
+    uint32_t localAddress;
+} HP_label;
+
+// State of a chunk, shared by the 2 phases
+typedef struct HP_chunk {
+    const char* start;
+    size_t length;
+
+    // Phase 1 results
+    uint32_t instructionCount;
+    uint32_t lineCount;
+    HP_label* labels;
+    uint32_t labelCount;
+    uint32_t labelCapacity;
+
+    // Phase 2 inputs and results
+    uint32_t firstAddress;
+    uint32_t firstLine;
+    HackInstructions* p_list;
+    HackSymbolTable* p_table;
+    HackFixups fixups;
+    HackDiagnostics diag;
+} HP_chunk;
+
+int HP_available_jobs() {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    return online < 1 ? 1 : (int)online;
+}
+
+static void HP_push_label(HP_chunk* p_chunk, const HackSlice* name,
+                          uint32_t localAddress) {
+    if (p_chunk->labelCount == p_chunk->labelCapacity) {
+        p_chunk->labelCapacity =
+            p_chunk->labelCapacity == 0 ? 256 : 2 * p_chunk->labelCapacity;
+        HP_label* newLabels = realloc(
+            p_chunk->labels, p_chunk->labelCapacity * sizeof(HP_label));
+        if (newLabels == NULL) {
+            fprintf(stderr, "Could not grow the labels of a chunk\n");
+            exit(1);
+        }
+        p_chunk->labels = newLabels;
+    }
+    p_chunk->labels[p_chunk->labelCount].name = *name;
+    p_chunk->labels[p_chunk->labelCount].localAddress = localAddress;
+    p_chunk->labelCount++;
+}
+
+// Phase 1 : count instructions and collect labels
+static void* HP_scan_chunk(void* arg) {
+    HP_chunk* p_chunk = arg;
+    HackLexer lexer;
+    HL_init(&lexer, p_chunk->start, p_chunk->length);
+    HackLine line;
+    uint32_t instructionCount = 0;
+    while (HL_next_line(&lexer, &line)) {
+        if (line.type == HL_LABEL) {
+            if (line.symbol.length > 0) {
+                HP_push_label(p_chunk, &line.symbol, instructionCount);
+            }
+        } else {
+            ++instructionCount;
+        }
+    }
+    p_chunk->instructionCount = instructionCount;
+    p_chunk->lineCount = lexer.lineNumber;
+    return NULL;
+}
+
+// Phase 2 : encode the chunk in place
+// The symbol table is only read here, so it is safe to share
+static void* HP_encode_chunk(void* arg) {
+    HP_chunk* p_chunk = arg;
+    HackLexer lexer;
+    HL_init(&lexer, p_chunk->start, p_chunk->length);
+    lexer.lineNumber = p_chunk->firstLine;
+    HackLine line;
+    HackInstruction* words = p_chunk->p_list->words;
+    uint32_t address = p_chunk->firstAddress;
+    while (HL_next_line(&lexer, &line)) {
+        if (line.type == HL_LABEL) {
+            continue;
+        }
+        HackInstruction instruction = 0;
+        if (line.type == HL_A_INSTRUCTION) {
+            int32_t value;
+            if (HL_slice_to_number(&line.symbol, &value)) {
+                set_AInstruction(&instruction, value);
+            } else {
+                int64_t labelValue =
+                    ST_check_for_slice(p_chunk->p_table, &line.symbol);
+                if (labelValue != KEY_NOT_FOUND) {
+                    set_AInstruction(&instruction, labelValue);
+                } else {
+                    // Variable, allocated when all chunks are done
+                    HF_push_back(&p_chunk->fixups, address, &line.symbol);
+                }
+            }
+        } else if (!set_CInstruction(&instruction, &line.dest, &line.comp,
+                                     &line.jump)) {
+            HD_error(&p_chunk->diag, line.lineNumber, "Unknown C instruction");
+        }
+        words[address++] = instruction;
+    }
+    return NULL;
+}
+
+// Runs routine on every chunk, each in its own thread
+static void HP_run_on_chunks(HP_chunk* chunks, int chunkCount,
+                             void* (*routine)(void*)) {
+    pthread_t threads[HP_MAX_JOBS];
+    bool started[HP_MAX_JOBS];
+    for (int i = 0; i < chunkCount; ++i) {
+        started[i] = pthread_create(threads + i, NULL, routine, chunks + i) == 0;
+        if (!started[i]) {
+            // Not enough resources for a thread, do the work here
+            routine(chunks + i);
+        }
+    }
+    for (int i = 0; i < chunkCount; ++i) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+}
+
+uint32_t source_to_machine_code_parallel(const char* source, size_t length,
+                                         HackInstructions* p_list,
+                                         HackSymbolTable* p_table, int jobs,
+                                         HackDiagnostics* p_diag) {
+    if (jobs > HP_MAX_JOBS) {
+        jobs = HP_MAX_JOBS;
+    }
+    if ((size_t)jobs > length / HP_MIN_CHUNK_SIZE) {
+        jobs = length / HP_MIN_CHUNK_SIZE;
+    }
+    if (jobs <= 1 || length < HP_MIN_PARALLEL_SIZE) {
+        return source_to_machine_code(source, length, p_list, p_table,
+                                      p_diag);
+    }
+
+    // Cut the source in line-aligned chunks of about the same size
+    HP_chunk chunks[HP_MAX_JOBS];
+    int chunkCount = 0;
+    const char* end = source + length;
+    const char* chunkStart = source;
+    for (int i = 0; i < jobs && chunkStart < end; ++i) {
+        const char* chunkEnd = source + length / jobs * (i + 1);
+        if (i == jobs - 1 || chunkEnd >= end) {
+            chunkEnd = end;
+        } else {
+            const char* newline = memchr(chunkEnd, '\n', end - chunkEnd);
+            chunkEnd = newline == NULL ? end : newline + 1;
+        }
+        if (chunkEnd <= chunkStart) {
+            continue;
+        }
+        HP_chunk* p_chunk = chunks + chunkCount++;
+        memset(p_chunk, 0, sizeof(HP_chunk));
+        p_chunk->start = chunkStart;
+        p_chunk->length = chunkEnd - chunkStart;
+        p_chunk->p_list = p_list;
+        p_chunk->p_table = p_table;
+        HF_init(&p_chunk->fixups);
+        HD_init(&p_chunk->diag, p_diag == NULL || p_diag->print);
+        chunkStart = chunkEnd;
+    }
+
+    HP_run_on_chunks(chunks, chunkCount, HP_scan_chunk);
+
+    // Prefix sum of the counts, and labels merged in source order so that
+    // the first definition of a label is kept
+    uint32_t firstAddress = p_list->size;
+    uint32_t firstLine = 0;
+    for (int i = 0; i < chunkCount; ++i) {
+        chunks[i].firstAddress = firstAddress;
+        chunks[i].firstLine = firstLine;
+        for (uint32_t j = 0; j < chunks[i].labelCount; ++j) {
+            ST_add_slice(p_table, &chunks[i].labels[j].name,
+                         firstAddress + chunks[i].labels[j].localAddress);
+        }
+        firstAddress += chunks[i].instructionCount;
+        firstLine += chunks[i].lineCount;
+    }
+    uint32_t instructionCount = firstAddress - p_list->size;
+    HI_resize(p_list, firstAddress);
+
+    HP_run_on_chunks(chunks, chunkCount, HP_encode_chunk);
+
+    // Deterministic merge of the unresolved references and of the errors
+    HackFixups fixups;
+    HF_init(&fixups);
+    for (int i = 0; i < chunkCount; ++i) {
+        HF_append(&fixups, &chunks[i].fixups);
+        if (p_diag != NULL) {
+            HD_merge(p_diag, &chunks[i].diag);
+        }
+        HF_delete_all_fixups(&chunks[i].fixups);
+        free(chunks[i].labels);
+    }
+    parser_resolve_fixups(&fixups, p_list, p_table);
+    HF_delete_all_fixups(&fixups);
+    return instructionCount;
+}
@@ -0,0 +1,41 @@
+// Parallel assembly of large sources
+// The source is cut in line-aligned chunks, and each chunk is read by its own
+// thread in 2 phases :
+// 1) count the instructions and collect the labels of the chunk,
+// 2) encode the chunk at its ROM offset in the shared instructions array.
+// Between the 2 phases, a prefix sum of the counts gives the offset of each
+// chunk, and the labels are merged in the symbol table in chunk order.
+// After phase 2, the unresolved references of all chunks are merged in
+// chunk order too, so variables get the same addresses as in a sequential
+// assembly.
+#ifndef HACKPARALLEL_H_
+#define HACKPARALLEL_H_
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif  // _POSIX_C_SOURCE
+
+// Sources smaller than this are assembled sequentially
+#define HP_MIN_PARALLEL_SIZE (1 << 20)
+// No chunk is made smaller than this
+#define HP_MIN_CHUNK_SIZE (1 << 18)
+#define HP_MAX_JOBS 64
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "HackDiagnostics.h"
+#include "HackInstructionList.h"
+#include "HackSymbolTable.h"
+
+// Returns the number of online processors
+int HP_available_jobs();
+
+// Same as source_to_machine_code, using up to jobs threads
+// Falls back to source_to_machine_code if jobs <= 1 or if the source is too
+// small to be worth splitting
+uint32_t source_to_machine_code_parallel(const char* source, size_t length,
+                                         HackInstructions* p_list,
+                                         HackSymbolTable* p_table, int jobs,
+                                         HackDiagnostics* p_diag);
+
+#endif  // HACKPARALLEL_H_
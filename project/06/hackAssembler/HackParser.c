@@ -1,166 +1,82 @@
 #include "HackParser.h"
 
-uint32_t symbolless_stream_to_machine_code(FILE* filestream,
-                                           HackInstructions* p_list,
-                                           HackSymbolTable* p_table) {
-    char line[LINE_BUFFERSIZE];
-    uint32_t instructionCount = 0;
-    uint16_t variableAddress = 16;
-    while (fgets(line, 255, filestream) != NULL) {
-        char* nextWord = NULL;
-        char strippedInstruction[LINE_BUFFERSIZE];
-        strippedInstruction[0] = '\0';
-        // This loop uses strtok to remove all whitespaces in line.
-        // Also, if a bracket or a comment symbol is found, we skip to
-        // next line
-        nextWord = strtok(line, " \r\n\t");
-        while (nextWord != NULL) {
-            // Stop reading the line if there is one of those symbols
-            if (strncmp(nextWord, "//", 2) == 0 ||
-                strncmp(nextWord, "(", 1) == 0) {
-                break;
-            }
-            // Otherwise, add the new meaningful symbol, and go the next one
-            strcat(strippedInstruction, nextWord);
-            nextWord = strtok(NULL, " ");
-        }
-        // This is needed to skip comment lines or open/close brackets
-        if (strlen(strippedInstruction) == 0) {
-            continue;
-        }
+uint32_t source_to_machine_code(const char* source, size_t length,
+                                HackInstructions* p_list,
+                                HackSymbolTable* p_table,
+                                HackDiagnostics* p_diag) {
+    uint32_t firstAddress = p_list->size;
+    HackFixups fixups;
+    HF_init(&fixups);
+    HackLexer lexer;
+    HL_init(&lexer, source, length);
+    HackLine line;
+    while (HL_next_line(&lexer, &line)) {
+        parser_add_line(&line, p_list, p_table, &fixups, p_diag);
+    }
 
-        // See if line[0] is @
-        // a) if it is, then Ainstruction
-        if (strncmp(strippedInstruction, "@", 1) == 0) {
-            // If the value after the @ is not numeric, then we
-            // should look it up in the symbol table
-            // if found we replace it,
-            // if not, we make the 16++ foo
-            HackInstruction* Ainstruction = malloc(sizeof(HackInstruction));
-            char* label = strtok(strippedInstruction, "@\r\t\n /");
-            // If the first char of the label is a digit, then we assume it's an
-            // address
-            if (isdigit(label[0])) {
-                set_AInstruction(Ainstruction, strtol(label, NULL, 10));
-            } else {  // else we have to convert a label
-                // look the label in hash table
-                int64_t labelValue = ST_check_for_key(p_table, label);
-                if (labelValue != KEY_NOT_FOUND) {
-                    // If it exists, set_AInstruction(Ainstr,
-                    // symbol_table(label));
-                    set_AInstruction(Ainstruction, labelValue);
-                } else {
-                    // If it doesn't, add to the symbol table with label->
-                    // variableAddress and increment variableAddress
-                    ST_add_key(p_table, label, variableAddress);
-                    set_AInstruction(Ainstruction, variableAddress);
-                    variableAddress++;
-                }
-            }
-            Ainstruction->lineNumber = instructionCount;
-            HI_push_back(p_list, Ainstruction);
-            /* fprintf(stderr, "%d ", instructionCount); */
-            ++instructionCount;
-            /* fprintf(stderr, "State of the Machine Code : \n"); */
-            /* HI_print_all_instructions(*p_list); */
+    parser_resolve_fixups(&fixups, p_list, p_table);
+    HF_delete_all_fixups(&fixups);
+    return p_list->size - firstAddress;
+}
 
-        } else {  // b) else, parse for C instruction
-            // TODO : make the string uppercase
-            char* dest = NULL;
-            char* comp = NULL;
-            // Check if destination is specified before cutting
-            // the C-instruction string
-            if (strchr(strippedInstruction, '=') != NULL) {
-                dest = strtok(strippedInstruction, "=");
-                comp = strtok(NULL, ";\r\n");
-            } else {
-                comp = strtok(strippedInstruction, ";\r\n");
-            }
-            char* jump = strtok(NULL, "\r\n");
-            HackInstruction* Cinstruction = malloc(sizeof(HackInstruction));
-            set_CInstruction(Cinstruction, dest, comp, jump);
-            Cinstruction->lineNumber = instructionCount;
-            HI_push_back(p_list, Cinstruction);
-            /* fprintf(stderr, "%d ", instructionCount); */
-            ++instructionCount;
-            /* fprintf(stderr, "State of the Machine Code : \n"); */
-            /* HI_print_all_instructions(*p_list); */
+void parser_add_line(const HackLine* p_line, HackInstructions* p_list,
+                     HackSymbolTable* p_table, HackFixups* p_fixups,
+                     HackDiagnostics* p_diag) {
+    // If this is a label, it points to the next instruction
+    // Only the first definition of a label is kept
+    if (p_line->type == HL_LABEL) {
+        if (p_line->symbol.length > 0 &&
+            ST_check_for_slice(p_table, &p_line->symbol) == KEY_NOT_FOUND) {
+            ST_add_slice(p_table, &p_line->symbol, p_list->size);
         }
+        return;
     }
-    return instructionCount;
-}
 
-uint32_t parser_labels_pass(FILE* filestream, HackSymbolTable* p_table) {
-    char line[LINE_BUFFERSIZE];
-    uint32_t instructionCount = 0;
-    int labelsInARow = 0;
-    char* newLabel[LABELS_IN_A_ROW_BUFFER];
-    for (int i = 0; i < LABELS_IN_A_ROW_BUFFER; ++i) {
-        newLabel[i] = NULL;
-    }
-    while (fgets(line, 255, filestream) != NULL) {
-        char* nextWord;
-        char strippedInstruction[LINE_BUFFERSIZE];
-        strippedInstruction[0] = '\0';
-        // This loop uses strtok to remove all whitespaces in line.
-        // Also, if a bracket or a comment symbol is found, we skip to
-        // next line
-        nextWord = strtok(line, " \r\n\t");
-        while (nextWord != NULL) {
-            // Stop reading the line if there is one of those symbols
-            if (strncmp(nextWord, "//", 2) == 0) {
-                break;
+    // a) A instruction
+    if (p_line->type == HL_A_INSTRUCTION) {
+        HackInstruction Ainstruction = 0;
+        int32_t address;
+        // If the first char of the label is a digit, then we assume it's an
+        // address
+        if (HL_slice_to_number(&p_line->symbol, &address)) {
+            set_AInstruction(&Ainstruction, address);
+        } else {  // else we have to convert a label
+            // look the label in hash table
+            int64_t labelValue = ST_check_for_slice(p_table, &p_line->symbol);
+            if (labelValue != KEY_NOT_FOUND) {
+                set_AInstruction(&Ainstruction, labelValue);
+            } else {
+                // Either a label defined further down, or a variable.
+                // We can't tell yet, so the word is patched at the end
+                HF_push_back(p_fixups, p_list->size, &p_line->symbol);
             }
-            // Otherwise, add the new meaningful symbol, and go the next one
-            strcat(strippedInstruction, nextWord);
-            nextWord = strtok(NULL, " \r\n\t");
-        }
-        // This is needed to skip comment lines or open/close brackets
-        if (strlen(strippedInstruction) == 0) {
-            continue;
         }
+        HI_push_back(p_list, Ainstruction);
 
-        // If this is a label, save it for next line.
-        if (strncmp(strippedInstruction, "(", 1) == 0) {
-            newLabel[labelsInARow] =
-                strdup(strtok(strippedInstruction, "()\n"));
-            ++labelsInARow;
-        } else if (labelsInARow > 0) {
-            // If we're here, this is a real instruction, and we just flush the
-            // table of newLabels in the Symbol table
-            for (int i = 0; i < labelsInARow; ++i) {
-                /* fprintf(stderr, "Label to write : %s -> ",
-                 *       strstrip(newLabel[i]));
-                 */
-                ST_add_key(p_table, strstrip(newLabel[i]), instructionCount);
-            }
-            for (int i = 0; i < LABELS_IN_A_ROW_BUFFER; ++i) {
-                free(newLabel[i]);
-                newLabel[i] = NULL;
-            }
-            labelsInARow = 0;
-            ++instructionCount;
-        } else {
-            ++instructionCount;
+    } else {  // b) C instruction
+        HackInstruction Cinstruction;
+        if (!set_CInstruction(&Cinstruction, &p_line->dest, &p_line->comp,
+                              &p_line->jump)) {
+            HD_error(p_diag, p_line->lineNumber, "Unknown C instruction");
         }
-        /* fprintf(stderr, "Instruction count : %d\n", instructionCount); */
+        HI_push_back(p_list, Cinstruction);
     }
-    return instructionCount;
 }
 
-char* strstrip(char* s) {
-    size_t size;
-    char* end;
-
-    size = strlen(s);
-
-    if (!size) return s;
-
-    end = s + size - 1;
-    while (end >= s && isspace(*end)) end--;
-    *(end + 1) = '\0';
-
-    while (*s && isspace(*s)) s++;
-
-    return s;
+uint16_t parser_resolve_fixups(HackFixups* p_fixups, HackInstructions* p_list,
+                               HackSymbolTable* p_table) {
+    uint16_t variableAddress = FIRST_VARIABLE_ADDRESS;
+    for (uint32_t i = 0; i < p_fixups->size; ++i) {
+        HackFixup* fixup = p_fixups->fixups + i;
+        int64_t labelValue = ST_check_for_slice(p_table, &fixup->symbol);
+        if (labelValue == KEY_NOT_FOUND) {
+            // Fixups are in source order, so the first unresolved
+            // reference is also the first appearance of the variable
+            ST_add_slice(p_table, &fixup->symbol, variableAddress);
+            labelValue = variableAddress;
+            variableAddress++;
+        }
+        set_AInstruction(HI_at(p_list, fixup->address), labelValue);
+    }
+    return variableAddress - FIRST_VARIABLE_ADDRESS;
 }
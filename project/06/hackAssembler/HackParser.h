@@ -1,23 +1,39 @@
 #ifndef HACKPARSER_H_
 #define HACKPARSER_H_
-#define LINE_BUFFERSIZE 256
-#define LABELS_IN_A_ROW_BUFFER 32
-#ifndef __STDC_WANT_LIB_EXT2__
-#define __STDC_WANT_LIB_EXT2__ 1
-#endif  // __STDC_WANT_LIB_EXT2__
+#define FIRST_VARIABLE_ADDRESS 16
 
-#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "HackDiagnostics.h"
+#include "HackFixupList.h"
 #include "HackInstructionList.h"
+#include "HackLexer.h"
 #include "HackSymbolTable.h"
 
-uint32_t symbolless_stream_to_machine_code(FILE* filestream,
-                                           HackInstructions* p_list,
-                                           HackSymbolTable* p_table);
-uint32_t parser_labels_pass(FILE* filestream, HackSymbolTable* p_table);
-
-char* strstrip(char* s);
+// Assembles the source buffer in a single pass.
+// Labels are added to the symbol table as soon as they are read, and every
+// A instruction that references a symbol not known yet is emitted as a
+// placeholder and recorded as a fixup.
+// Once the source is read, the fixups are patched : the symbols that are
+// still unresolved become variables starting at FIRST_VARIABLE_ADDRESS, in
+// order of first appearance.
+// Errors are recorded in p_diag, which may be NULL to only print them
+// Returns the count of instructions written in p_list
+uint32_t source_to_machine_code(const char* source, size_t length,
+                                HackInstructions* p_list,
+                                HackSymbolTable* p_table,
+                                HackDiagnostics* p_diag);
+// Encodes p_line at the end of p_list, as source_to_machine_code does :
+// a label is added to p_table, and a reference to a symbol not in p_table
+// yet is recorded in p_fixups
+void parser_add_line(const HackLine* p_line, HackInstructions* p_list,
+                     HackSymbolTable* p_table, HackFixups* p_fixups,
+                     HackDiagnostics* p_diag);
+// Patches every fixup of p_fixups in p_list, allocating variables for the
+// symbols that are not in p_table.
+// Returns the count of allocated variables
+uint16_t parser_resolve_fixups(HackFixups* p_fixups, HackInstructions* p_list,
+                               HackSymbolTable* p_table);
 
 #endif  // HACKPARSER_H_
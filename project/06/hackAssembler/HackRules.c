@@ -0,0 +1,219 @@
+#include "HackRules.h"
+
+#include <string.h>
+
+// Value of a line that is not a valid C instruction in the words array
+#define HR_NO_WORD 0xFFFFFFFF
+
+void HR_init(HackRules* p_rules) {
+    p_rules->rules = NULL;
+    p_rules->size = 0;
+    p_rules->capacity = 0;
+    p_rules->source.data = NULL;
+    p_rules->source.length = 0;
+    p_rules->source.mapped = false;
+}
+
+static HackRule* HR_push_back(HackRules* p_rules) {
+    if (p_rules->size == p_rules->capacity) {
+        p_rules->capacity =
+            p_rules->capacity == 0 ? 64 : 2 * p_rules->capacity;
+        HackRule* newRules =
+            realloc(p_rules->rules, p_rules->capacity * sizeof(HackRule));
+        if (newRules == NULL) {
+            fprintf(stderr, "Could not grow the rules array\n");
+            exit(1);
+        }
+        p_rules->rules = newRules;
+    }
+    HackRule* p_rule = p_rules->rules + p_rules->size++;
+    memset(p_rule, 0, sizeof(HackRule));
+    return p_rule;
+}
+
+// Parses the instructions of [start, end[ separated by '/' into lines
+// Returns the number of lines, or -1 if one is not a C instruction
+static int HR_parse_side(const char* start, const char* end,
+                         HackLine* lines) {
+    int count = 0;
+    while (start < end) {
+        const char* separator = memchr(start, '/', end - start);
+        const char* partEnd = separator == NULL ? end : separator;
+        HackLexer lexer;
+        HL_init(&lexer, start, partEnd - start);
+        HackLine line;
+        if (HL_next_line(&lexer, &line)) {
+            if (count == HR_MAX_WINDOW || line.type != HL_C_INSTRUCTION) {
+                return -1;
+            }
+            lines[count++] = line;
+        } else if (separator != NULL) {
+            // Empty instruction between 2 separators
+            return -1;
+        }
+        start = separator == NULL ? end : separator + 1;
+    }
+    return count;
+}
+
+static int HR_compare_rules(const void* a, const void* b) {
+    const HackRule* ruleA = a;
+    const HackRule* ruleB = b;
+    if (ruleA->pattern[0] != ruleB->pattern[0]) {
+        return ruleA->pattern[0] < ruleB->pattern[0] ? -1 : 1;
+    }
+    // Longest pattern first
+    return (int)ruleB->patternLength - (int)ruleA->patternLength;
+}
+
+bool HR_load(HackRules* p_rules, const char* path) {
+    FILE* stream = fopen(path, "r");
+    if (stream == NULL) {
+        fprintf(stderr, "Could not open %s\n", path);
+        return false;
+    }
+    bool loaded = HS_load(&p_rules->source, stream);
+    fclose(stream);
+    if (!loaded) {
+        fprintf(stderr, "Could not read %s\n", path);
+        return false;
+    }
+
+    const char* cursor = p_rules->source.data;
+    const char* end = cursor + p_rules->source.length;
+    uint32_t lineNumber = 0;
+    while (cursor < end) {
+        const char* lineEnd = memchr(cursor, '\n', end - cursor);
+        lineEnd = lineEnd == NULL ? end : lineEnd;
+        const char* line = cursor;
+        cursor = lineEnd < end ? lineEnd + 1 : end;
+        lineNumber++;
+        while (line < lineEnd && (*line == ' ' || *line == '\t')) {
+            line++;
+        }
+        if (line == lineEnd || *line == '\r' ||
+            (lineEnd - line >= 2 && line[0] == '/' && line[1] == '/')) {
+            continue;
+        }
+
+        const char* arrow = line;
+        while (arrow + 1 < lineEnd && !(arrow[0] == '=' && arrow[1] == '>')) {
+            arrow++;
+        }
+        HackLine pattern[HR_MAX_WINDOW];
+        HackRule* p_rule = HR_push_back(p_rules);
+        int patternLength = arrow + 1 < lineEnd
+                                ? HR_parse_side(line, arrow, pattern)
+                                : -1;
+        int replacementLength =
+            patternLength > 0
+                ? HR_parse_side(arrow + 2, lineEnd, p_rule->replacement)
+                : -1;
+        bool valid = replacementLength >= 0 &&
+                     replacementLength < patternLength;
+        for (int i = 0; valid && i < patternLength; ++i) {
+            valid = set_CInstruction(p_rule->pattern + i, &pattern[i].dest,
+                                     &pattern[i].comp, &pattern[i].jump);
+        }
+        for (int i = 0; valid && i < replacementLength; ++i) {
+            HackInstruction word;
+            HackLine* p_line = p_rule->replacement + i;
+            valid = set_CInstruction(&word, &p_line->dest, &p_line->comp,
+                                     &p_line->jump);
+        }
+        if (!valid) {
+            fprintf(stderr, "Invalid rule on line %u of %s\n", lineNumber,
+                    path);
+            return false;
+        }
+        p_rule->patternLength = patternLength;
+        p_rule->replacementLength = replacementLength;
+    }
+    qsort(p_rules->rules, p_rules->size, sizeof(HackRule), HR_compare_rules);
+    return true;
+}
+
+// Returns the first rule whose pattern starts with word, or NULL
+static const HackRule* HR_first_rule(const HackRules* p_rules,
+                                     HackInstruction word) {
+    uint32_t low = 0;
+    uint32_t high = p_rules->size;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (p_rules->rules[middle].pattern[0] < word) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low < p_rules->size && p_rules->rules[low].pattern[0] == word) {
+        return p_rules->rules + low;
+    }
+    return NULL;
+}
+
+uint32_t HR_apply(const HackRules* p_rules, HackProgram* p_program) {
+    if (p_rules->size == 0 || p_program->size == 0) {
+        return 0;
+    }
+    // Encoded C instructions, so that patterns are compared as words
+    uint32_t* words = malloc(p_program->size * sizeof(uint32_t));
+    if (words == NULL) {
+        fprintf(stderr, "Could not allocate the rewriting words\n");
+        exit(1);
+    }
+    for (uint32_t i = 0; i < p_program->size; ++i) {
+        HackLine* p_line = p_program->lines + i;
+        HackInstruction word;
+        words[i] = p_line->type == HL_C_INSTRUCTION &&
+                           set_CInstruction(&word, &p_line->dest,
+                                            &p_line->comp, &p_line->jump)
+                       ? word
+                       : HR_NO_WORD;
+    }
+
+    uint32_t rewritten = 0;
+    uint32_t kept = 0;
+    uint32_t i = 0;
+    while (i < p_program->size) {
+        const HackRule* p_rule =
+            words[i] == HR_NO_WORD ? NULL : HR_first_rule(p_rules, words[i]);
+        const HackRule* end = p_rules->rules + p_rules->size;
+        for (; p_rule != NULL && p_rule < end &&
+               p_rule->pattern[0] == words[i];
+             ++p_rule) {
+            uint32_t length = p_rule->patternLength;
+            if (i + length > p_program->size) {
+                continue;
+            }
+            uint32_t k = 1;
+            while (k < length && words[i + k] == p_rule->pattern[k]) {
+                k++;
+            }
+            if (k == length) {
+                break;
+            }
+        }
+        if (p_rule == NULL || p_rule == end ||
+            p_rule->pattern[0] != words[i]) {
+            p_program->lines[kept++] = p_program->lines[i++];
+            continue;
+        }
+        uint32_t lineNumber = p_program->lines[i].lineNumber;
+        for (uint32_t k = 0; k < p_rule->replacementLength; ++k) {
+            p_program->lines[kept] = p_rule->replacement[k];
+            p_program->lines[kept++].lineNumber = lineNumber;
+        }
+        i += p_rule->patternLength;
+        rewritten++;
+    }
+    p_program->size = kept;
+    free(words);
+    return rewritten;
+}
+
+void HR_delete_all_rules(HackRules* p_rules) {
+    free(p_rules->rules);
+    HS_release(&p_rules->source);
+    HR_init(p_rules);
+}
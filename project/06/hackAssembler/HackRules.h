@@ -0,0 +1,51 @@
+// Rewrite rules for windows of C instructions
+// A rule file, as written by HackSuperoptimizer, holds one rule per line :
+//     M=M-1 / A=M => AM=M-1
+// The instructions of a side are separated by '/', and the right side may
+// be empty. Blank lines and lines starting with // are ignored.
+// A rule is applied wherever its left side is found in a row of C
+// instructions (no label in between), so both sides must leave A, D and
+// the memory in the same state, whatever that state was.
+#ifndef HACKRULES_H_
+#define HACKRULES_H_
+
+#define HR_MAX_WINDOW 5
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "HackInstruction.h"
+#include "HackLexer.h"
+#include "HackOptimizer.h"
+
+typedef struct HackRule HackRule;
+struct HackRule {
+    HackInstruction pattern[HR_MAX_WINDOW];
+    uint32_t patternLength;
+    // Slices into the rule file
+    HackLine replacement[HR_MAX_WINDOW];
+    uint32_t replacementLength;
+};
+
+typedef struct HackRules HackRules;
+struct HackRules {
+    HackRule* rules;
+    uint32_t size;
+    uint32_t capacity;
+    // Content of the rule file, which the rules point into
+    HackSource source;
+};
+
+void HR_init(HackRules* p_rules);
+// Reads the rules of the file at path
+// Returns false (after printing the faulty line on stderr) if the file
+// can't be read or holds an invalid rule
+bool HR_load(HackRules* p_rules, const char* path);
+// Rewrites every window of p_program matching a rule, the longest rule
+// first. Returns the number of rewritten windows
+uint32_t HR_apply(const HackRules* p_rules, HackProgram* p_program);
+void HR_delete_all_rules(HackRules* p_rules);
+
+#endif  // HACKRULES_H_
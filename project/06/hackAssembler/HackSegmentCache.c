@@ -0,0 +1,411 @@
+#include "HackSegmentCache.h"
+
+#include <ctype.h>
+
+#include "HackParser.h"
+
+// Segment read from the cache file, its fields point into the file buffer
+typedef struct HSC_cached {
+    uint64_t hash;
+    uint32_t length;
+    uint32_t instructionCount;
+    uint32_t labelCount;
+    uint32_t relocationCount;
+    const char* words;
+    const char* labels;
+    const char* relocations;
+    const char* end;
+} HSC_cached;
+
+typedef struct HSC_reader {
+    const char* cursor;
+    const char* end;
+    bool valid;
+} HSC_reader;
+
+uint64_t HSC_hash(const char* text, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= (unsigned char)text[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Returns a pointer to the next size bytes of the reader, or NULL
+static const char* HSC_read(HSC_reader* p_reader, size_t size) {
+    if (!p_reader->valid || (size_t)(p_reader->end - p_reader->cursor) < size) {
+        p_reader->valid = false;
+        return NULL;
+    }
+    const char* data = p_reader->cursor;
+    p_reader->cursor += size;
+    return data;
+}
+
+static uint32_t HSC_read_u32(HSC_reader* p_reader) {
+    uint32_t value = 0;
+    const char* data = HSC_read(p_reader, sizeof(value));
+    if (data != NULL) {
+        memcpy(&value, data, sizeof(value));
+    }
+    return value;
+}
+
+static uint64_t HSC_read_u64(HSC_reader* p_reader) {
+    uint64_t value = 0;
+    const char* data = HSC_read(p_reader, sizeof(value));
+    if (data != NULL) {
+        memcpy(&value, data, sizeof(value));
+    }
+    return value;
+}
+
+// Skips count (u32 value, u32 length, name) records
+static void HSC_skip_symbols(HSC_reader* p_reader, uint32_t count) {
+    for (uint32_t i = 0; i < count && p_reader->valid; ++i) {
+        HSC_read_u32(p_reader);
+        HSC_read(p_reader, HSC_read_u32(p_reader));
+    }
+}
+
+static int HSC_compare_cached(const void* a, const void* b) {
+    uint64_t hashA = ((const HSC_cached*)a)->hash;
+    uint64_t hashB = ((const HSC_cached*)b)->hash;
+    return hashA < hashB ? -1 : (hashA > hashB ? 1 : 0);
+}
+
+// Parses the cache file in source, and returns its segments sorted by hash
+// Returns NULL (and 0 in p_count) if the file is not a valid cache
+static HSC_cached* HSC_parse(const HackSource* source, uint32_t* p_count) {
+    *p_count = 0;
+    HSC_reader reader = {source->data, source->data + source->length, true};
+    const char* magic = HSC_read(&reader, HSC_MAGIC_LENGTH);
+    if (magic == NULL || memcmp(magic, HSC_MAGIC, HSC_MAGIC_LENGTH) != 0) {
+        return NULL;
+    }
+    uint32_t count = HSC_read_u32(&reader);
+    // Each segment takes at least 24 bytes, this bounds the allocation
+    if (!reader.valid || count > source->length / 24) {
+        return NULL;
+    }
+    HSC_cached* cached = malloc((count + 1) * sizeof(HSC_cached));
+    if (cached == NULL) {
+        return NULL;
+    }
+    for (uint32_t i = 0; i < count && reader.valid; ++i) {
+        cached[i].hash = HSC_read_u64(&reader);
+        cached[i].length = HSC_read_u32(&reader);
+        cached[i].instructionCount = HSC_read_u32(&reader);
+        cached[i].labelCount = HSC_read_u32(&reader);
+        cached[i].relocationCount = HSC_read_u32(&reader);
+        cached[i].words = HSC_read(
+            &reader, (size_t)cached[i].instructionCount * sizeof(uint16_t));
+        cached[i].labels = reader.cursor;
+        HSC_skip_symbols(&reader, cached[i].labelCount);
+        cached[i].relocations = reader.cursor;
+        HSC_skip_symbols(&reader, cached[i].relocationCount);
+        cached[i].end = reader.cursor;
+    }
+    if (!reader.valid) {
+        free(cached);
+        return NULL;
+    }
+    qsort(cached, count, sizeof(HSC_cached), HSC_compare_cached);
+    *p_count = count;
+    return cached;
+}
+
+static HSC_cached* HSC_find(HSC_cached* cached, uint32_t count,
+                            const HackSegment* p_segment) {
+    if (count == 0) {
+        return NULL;
+    }
+    HSC_cached key;
+    key.hash = p_segment->hash;
+    HSC_cached* found =
+        bsearch(&key, cached, count, sizeof(HSC_cached), HSC_compare_cached);
+    if (found == NULL || found->length != p_segment->length) {
+        return NULL;
+    }
+    return found;
+}
+
+static bool is_function_label(const char* name, size_t length) {
+    if (length == 0 || memchr(name, '$', length) != NULL) {
+        return false;
+    }
+    size_t suffix = length;
+    while (suffix > 0 && name[suffix - 1] != '.') {
+        suffix--;
+    }
+    if (suffix == 0 || suffix == length) {
+        return true;
+    }
+    for (size_t i = suffix; i < length; ++i) {
+        if (!isdigit((unsigned char)name[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void HSC_push_segment(HackSegments* p_segments, const char* start,
+                             const char* end, uint32_t firstLine) {
+    if (p_segments->size == p_segments->capacity) {
+        p_segments->capacity =
+            p_segments->capacity == 0 ? 256 : 2 * p_segments->capacity;
+        HackSegment* newSegments =
+            realloc(p_segments->segments,
+                    p_segments->capacity * sizeof(HackSegment));
+        if (newSegments == NULL) {
+            fprintf(stderr, "Could not grow the segments array\n");
+            exit(1);
+        }
+        p_segments->segments = newSegments;
+    }
+    HackSegment* p_segment = p_segments->segments + p_segments->size++;
+    memset(p_segment, 0, sizeof(HackSegment));
+    p_segment->start = start;
+    p_segment->length = end - start;
+    p_segment->firstLine = firstLine;
+    p_segment->hash = HSC_hash(start, end - start);
+}
+
+// Cuts the source before every function label
+static void HSC_split(const char* source, size_t length,
+                      HackSegments* p_segments) {
+    const char* end = source + length;
+    const char* segmentStart = source;
+    uint32_t segmentLine = 0;
+    uint32_t lineNumber = 0;
+    const char* line = source;
+    while (line < end) {
+        const char* lineEnd = memchr(line, '\n', end - line);
+        lineEnd = lineEnd == NULL ? end : lineEnd + 1;
+        const char* first = line;
+        while (first < lineEnd && (*first == ' ' || *first == '\t')) {
+            first++;
+        }
+        if (first < lineEnd && *first == '(' && line > segmentStart) {
+            const char* close = memchr(first, ')', lineEnd - first);
+            if (close != NULL && is_function_label(first + 1, close - first - 1)) {
+                HSC_push_segment(p_segments, segmentStart, line, segmentLine);
+                segmentStart = line;
+                segmentLine = lineNumber;
+            }
+        }
+        lineNumber++;
+        line = lineEnd;
+    }
+    if (segmentStart < end) {
+        HSC_push_segment(p_segments, segmentStart, end, segmentLine);
+    }
+}
+
+// Copies a cached segment at the end of p_list
+static void HSC_reuse_segment(HackSegments* p_segments, HackSegment* p_segment,
+                              const HSC_cached* cached,
+                              HackInstructions* p_list,
+                              HackSymbolTable* p_table) {
+    uint32_t base = p_list->size;
+    HI_resize(p_list, base + cached->instructionCount);
+    memcpy(p_list->words + base, cached->words,
+           (size_t)cached->instructionCount * sizeof(uint16_t));
+
+    // The records were bounds checked by HSC_parse
+    HSC_reader reader = {cached->labels, cached->end, true};
+    for (uint32_t i = 0; i < cached->labelCount; ++i) {
+        uint32_t localAddress = HSC_read_u32(&reader);
+        HackSlice name;
+        name.length = HSC_read_u32(&reader);
+        name.start = HSC_read(&reader, name.length);
+        ST_add_slice(p_table, &name, base + localAddress);
+        HF_push_back(&p_segments->labels, base + localAddress, &name);
+    }
+    for (uint32_t i = 0; i < cached->relocationCount; ++i) {
+        uint32_t wordIndex = HSC_read_u32(&reader);
+        HackSlice name;
+        name.length = HSC_read_u32(&reader);
+        name.start = HSC_read(&reader, name.length);
+        HF_push_back(&p_segments->relocations, base + wordIndex, &name);
+    }
+    p_segment->instructionCount = cached->instructionCount;
+    p_segment->reused = true;
+}
+
+// Parses and encodes a segment at the end of p_list
+// Every symbol is left as a relocation, so the words can be cached
+static void HSC_encode_segment(HackSegments* p_segments,
+                               HackSegment* p_segment,
+                               HackInstructions* p_list,
+                               HackSymbolTable* p_table,
+                               HackDiagnostics* p_diag) {
+    uint32_t base = p_list->size;
+    HackLexer lexer;
+    HL_init(&lexer, p_segment->start, p_segment->length);
+    lexer.lineNumber = p_segment->firstLine;
+    HackLine line;
+    while (HL_next_line(&lexer, &line)) {
+        if (line.type == HL_LABEL) {
+            if (line.symbol.length > 0) {
+                ST_add_slice(p_table, &line.symbol, p_list->size);
+                HF_push_back(&p_segments->labels, p_list->size, &line.symbol);
+            }
+            continue;
+        }
+        HackInstruction instruction = 0;
+        if (line.type == HL_A_INSTRUCTION) {
+            int32_t value;
+            if (HL_slice_to_number(&line.symbol, &value)) {
+                set_AInstruction(&instruction, value);
+            } else {
+                HF_push_back(&p_segments->relocations, p_list->size,
+                             &line.symbol);
+            }
+        } else if (!set_CInstruction(&instruction, &line.dest, &line.comp,
+                                     &line.jump)) {
+            HD_error(p_diag, line.lineNumber, "Unknown C instruction");
+            p_segment->failed = true;
+        }
+        HI_push_back(p_list, instruction);
+    }
+    p_segment->instructionCount = p_list->size - base;
+}
+
+static void HSC_write_symbols(FILE* stream, const HackFixups* p_symbols,
+                              uint32_t first, uint32_t count, uint32_t base) {
+    for (uint32_t i = first; i < first + count; ++i) {
+        uint32_t localAddress = p_symbols->fixups[i].address - base;
+        uint32_t length = p_symbols->fixups[i].symbol.length;
+        fwrite(&localAddress, sizeof(localAddress), 1, stream);
+        fwrite(&length, sizeof(length), 1, stream);
+        fwrite(p_symbols->fixups[i].symbol.start, 1, length, stream);
+    }
+}
+
+// Writes the segments in a temporary file, then moves it to cachePath
+// The words are written before relocation, with 0 for relocated words
+// The failed segments are left out
+static bool HSC_write(const char* cachePath, const HackSegments* p_segments,
+                      const HackInstruction* unrelocated) {
+    size_t pathLength = strlen(cachePath);
+    char* tempPath = malloc(pathLength + 5);
+    if (tempPath == NULL) {
+        return false;
+    }
+    memcpy(tempPath, cachePath, pathLength);
+    memcpy(tempPath + pathLength, ".tmp", 5);
+    FILE* stream = fopen(tempPath, "wb");
+    if (stream == NULL) {
+        free(tempPath);
+        return false;
+    }
+    uint32_t storedCount = 0;
+    for (uint32_t i = 0; i < p_segments->size; ++i) {
+        if (!p_segments->segments[i].failed) {
+            storedCount++;
+        }
+    }
+    fwrite(HSC_MAGIC, 1, HSC_MAGIC_LENGTH, stream);
+    fwrite(&storedCount, sizeof(uint32_t), 1, stream);
+    for (uint32_t i = 0; i < p_segments->size; ++i) {
+        const HackSegment* p_segment = p_segments->segments + i;
+        if (p_segment->failed) {
+            continue;
+        }
+        fwrite(&p_segment->hash, sizeof(uint64_t), 1, stream);
+        fwrite(&p_segment->length, sizeof(uint32_t), 1, stream);
+        fwrite(&p_segment->instructionCount, sizeof(uint32_t), 1, stream);
+        fwrite(&p_segment->labelCount, sizeof(uint32_t), 1, stream);
+        fwrite(&p_segment->relocationCount, sizeof(uint32_t), 1, stream);
+        fwrite(unrelocated + p_segment->firstAddress, sizeof(uint16_t),
+               p_segment->instructionCount, stream);
+        HSC_write_symbols(stream, &p_segments->labels, p_segment->firstLabel,
+                          p_segment->labelCount, p_segment->firstAddress);
+        HSC_write_symbols(stream, &p_segments->relocations,
+                          p_segment->firstRelocation,
+                          p_segment->relocationCount,
+                          p_segment->firstAddress);
+    }
+    bool written = !ferror(stream);
+    written = fclose(stream) == 0 && written;
+    written = written && rename(tempPath, cachePath) == 0;
+    if (!written) {
+        remove(tempPath);
+    }
+    free(tempPath);
+    return written;
+}
+
+uint32_t source_to_machine_code_cached(const char* source, size_t length,
+                                       HackInstructions* p_list,
+                                       HackSymbolTable* p_table,
+                                       const char* cachePath,
+                                       HSC_stats* p_stats,
+                                       HackDiagnostics* p_diag) {
+    // The old cache stays loaded until the new one is written, since the
+    // names of the reused labels and relocations point into it
+    HackSource cacheSource = {NULL, 0, false};
+    HSC_cached* cached = NULL;
+    uint32_t cachedCount = 0;
+    FILE* cacheStream = fopen(cachePath, "rb");
+    if (cacheStream != NULL) {
+        if (HS_load(&cacheSource, cacheStream)) {
+            cached = HSC_parse(&cacheSource, &cachedCount);
+            if (cached == NULL && cacheSource.length > 0) {
+                fprintf(stderr, "Ignoring invalid segment cache %s\n",
+                        cachePath);
+            }
+        }
+        fclose(cacheStream);
+    }
+
+    HackSegments segments = {NULL, 0, 0, {NULL, 0, 0}, {NULL, 0, 0}};
+    HSC_split(source, length, &segments);
+
+    uint32_t firstAddress = p_list->size;
+    uint32_t reusedCount = 0;
+    for (uint32_t i = 0; i < segments.size; ++i) {
+        HackSegment* p_segment = segments.segments + i;
+        p_segment->firstAddress = p_list->size;
+        p_segment->firstLabel = segments.labels.size;
+        p_segment->firstRelocation = segments.relocations.size;
+        const HSC_cached* hit = HSC_find(cached, cachedCount, p_segment);
+        if (hit != NULL) {
+            HSC_reuse_segment(&segments, p_segment, hit, p_list, p_table);
+            reusedCount++;
+        } else {
+            HSC_encode_segment(&segments, p_segment, p_list, p_table,
+                               p_diag);
+        }
+        p_segment->labelCount = segments.labels.size - p_segment->firstLabel;
+        p_segment->relocationCount =
+            segments.relocations.size - p_segment->firstRelocation;
+    }
+
+    // Keep the words before relocation for the cache
+    HackInstruction* unrelocated =
+        malloc(((size_t)p_list->size + 1) * sizeof(HackInstruction));
+    if (unrelocated != NULL) {
+        memcpy(unrelocated, p_list->words,
+               (size_t)p_list->size * sizeof(HackInstruction));
+    }
+    parser_resolve_fixups(&segments.relocations, p_list, p_table);
+    if (unrelocated == NULL ||
+        !HSC_write(cachePath, &segments, unrelocated)) {
+        fprintf(stderr, "Could not write the segment cache %s\n", cachePath);
+    }
+
+    if (p_stats != NULL) {
+        p_stats->segmentCount = segments.size;
+        p_stats->reusedCount = reusedCount;
+    }
+    free(unrelocated);
+    free(segments.segments);
+    HF_delete_all_fixups(&segments.labels);
+    HF_delete_all_fixups(&segments.relocations);
+    free(cached);
+    HS_release(&cacheSource);
+    return p_list->size - firstAddress;
+}
@@ -0,0 +1,85 @@
+// Incremental assembly with a persistent segment cache
+// The source is split in segments, a new segment starting at every function
+// label. A function label is a label without '$' whose part after the last
+// '.' is not a number, so that the VM translator's (Class.function) labels
+// split segments, but not its (Class.function$...) or (TRUE_EQ.12) ones.
+//
+// The encoding of a segment only depends on its text, as long as every
+// reference to a symbol is left as a relocation. So the cache file maps the
+// hash of each segment's text to its words (with 0 for relocated words), the
+// labels it defines, and its relocations. On the next assembly, segments
+// whose hash is in the cache are not parsed again : their words are copied
+// and only their relocations are resolved, like the fixups of
+// source_to_machine_code, which keeps the same variable addresses.
+//
+// The cache file is written in the byte order of the machine.
+#ifndef HACKSEGMENTCACHE_H_
+#define HACKSEGMENTCACHE_H_
+
+#define HSC_MAGIC "HACKSEG1"
+#define HSC_MAGIC_LENGTH 8
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "HackDiagnostics.h"
+#include "HackFixupList.h"
+#include "HackInstructionList.h"
+#include "HackLexer.h"
+#include "HackSymbolTable.h"
+
+// A segment of the current source
+// Its labels and relocations are ranges of the arrays of HackSegments
+typedef struct HackSegment HackSegment;
+struct HackSegment {
+    uint64_t hash;
+    const char* start;
+    uint32_t length;
+    uint32_t firstLine;
+    uint32_t firstAddress;
+    uint32_t instructionCount;
+    uint32_t firstLabel;
+    uint32_t labelCount;
+    uint32_t firstRelocation;
+    uint32_t relocationCount;
+    // true if the segment was copied from the cache
+    bool reused;
+    // true if the segment has errors, so that it is not cached and they are
+    // reported again on the next assembly
+    bool failed;
+};
+
+typedef struct HackSegments HackSegments;
+struct HackSegments {
+    HackSegment* segments;
+    uint32_t size;
+    uint32_t capacity;
+    // Labels defined by the segments, as (absolute address, name) pairs
+    HackFixups labels;
+    // References to symbols, as (absolute address of the word, name) pairs
+    HackFixups relocations;
+};
+
+typedef struct HSC_stats {
+    uint32_t segmentCount;
+    uint32_t reusedCount;
+} HSC_stats;
+
+// FNV-1a hash of the text of a segment
+uint64_t HSC_hash(const char* text, size_t length);
+
+// Same as source_to_machine_code, reusing the segments found in the cache
+// file at cachePath and writing the segments of source back to it.
+// A missing or invalid cache file is treated as an empty cache.
+// p_stats and p_diag may be NULL
+uint32_t source_to_machine_code_cached(const char* source, size_t length,
+                                       HackInstructions* p_list,
+                                       HackSymbolTable* p_table,
+                                       const char* cachePath,
+                                       HSC_stats* p_stats,
+                                       HackDiagnostics* p_diag);
+
+#endif  // HACKSEGMENTCACHE_H_
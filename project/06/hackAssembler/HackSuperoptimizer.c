@@ -0,0 +1,449 @@
+// Superoptimizer for short windows of C instructions
+// Usage : HackSuperoptimizer file.asm... > rules
+// Every row of 2 to HR_MAX_WINDOW C instructions without jump found in the
+// files is a window. For each window, all the sequences of fewer
+// instructions (up to HSO_MAX_SEARCH_LENGTH) are tried, shortest first, and
+// the first one that leaves A, D and the memory in the same state as the
+// window is written as a rule that the assembler applies with --rules.
+//
+// The instructions are run with HI_alu on the words set_CInstruction
+// encodes. A candidate has to match the window on HSO_QUICK_TESTS chosen
+// states (0, 1, -1, 0x8000, aliased A and D...) and then on HSO_FULL_TESTS
+// random ones. This is testing, not a proof, so the rule file is meant to
+// be read before being used.
+#include <string.h>
+
+#include "HackInstruction.h"
+#include "HackLexer.h"
+#include "HackRules.h"
+
+#define HSO_MAX_SEARCH_LENGTH 3
+#define HSO_QUICK_TESTS 32
+#define HSO_FULL_TESTS 4096
+// Each instruction touches at most one cell
+#define HSO_MAX_CELLS (2 * HR_MAX_WINDOW)
+#define HSO_RAM_MASK 0x7FFF
+
+static const char* const HSO_COMPS[] = {
+    "0",   "1",   "-1",  "D",   "A",   "!D",  "!A",  "-D",  "-A",  "D+1",
+    "A+1", "D-1", "A-1", "D+A", "D-A", "A-D", "D&A", "D|A", "M",   "!M",
+    "-M",  "M+1", "M-1", "D+M", "D-M", "M-D", "D&M", "D|M"};
+static const char* const HSO_DESTS[] = {"M",  "D",  "MD", "A",
+                                        "AM", "AD", "AMD"};
+#define HSO_COMP_COUNT (sizeof(HSO_COMPS) / sizeof(HSO_COMPS[0]))
+#define HSO_DEST_COUNT (sizeof(HSO_DESTS) / sizeof(HSO_DESTS[0]))
+#define HSO_ALPHABET_SIZE (HSO_COMP_COUNT * HSO_DEST_COUNT)
+
+// Instruction that can appear in a found sequence
+typedef struct HSO_letter {
+    HackInstruction word;
+    char text[8];
+} HSO_letter;
+
+// State of the machine : registers and the cells written so far
+// The cells never written hold a value derived from the seed
+typedef struct HSO_machine {
+    uint16_t a;
+    uint16_t d;
+    uint32_t seed;
+    uint16_t cellAddress[HSO_MAX_CELLS];
+    uint16_t cellValue[HSO_MAX_CELLS];
+    int cellCount;
+} HSO_machine;
+
+typedef struct HSO_window {
+    HackInstruction words[HR_MAX_WINDOW];
+    uint32_t length;
+    // Words saved by the rule found for the window, 0 if none
+    uint32_t saving;
+} HSO_window;
+
+typedef struct HSO_windows {
+    HSO_window* windows;
+    uint32_t size;
+    uint32_t capacity;
+} HSO_windows;
+
+static HSO_letter alphabet[HSO_ALPHABET_SIZE];
+static HSO_machine quickTests[HSO_QUICK_TESTS];
+static HSO_machine fullTests[HSO_FULL_TESTS];
+static HSO_machine quickExpected[HSO_QUICK_TESTS];
+static HSO_machine fullExpected[HSO_FULL_TESTS];
+
+static uint32_t HSO_random(uint32_t* p_state) {
+    // xorshift32
+    uint32_t x = *p_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *p_state = x;
+    return x;
+}
+
+static uint16_t HSO_initial_cell(const HSO_machine* p_machine,
+                                 uint16_t address) {
+    uint32_t x = p_machine->seed ^ (address * 2654435761u);
+    // Some states make memory hold the registers, to catch aliasing
+    switch (p_machine->seed & 7) {
+        case 1:
+            return p_machine->a;
+        case 2:
+            return p_machine->d;
+        default:
+            return HSO_random(&x) >> 8;
+    }
+}
+
+static uint16_t HSO_read(const HSO_machine* p_machine, uint16_t address) {
+    for (int i = 0; i < p_machine->cellCount; ++i) {
+        if (p_machine->cellAddress[i] == address) {
+            return p_machine->cellValue[i];
+        }
+    }
+    return HSO_initial_cell(p_machine, address);
+}
+
+static void HSO_write(HSO_machine* p_machine, uint16_t address,
+                      uint16_t value) {
+    for (int i = 0; i < p_machine->cellCount; ++i) {
+        if (p_machine->cellAddress[i] == address) {
+            p_machine->cellValue[i] = value;
+            return;
+        }
+    }
+    p_machine->cellAddress[p_machine->cellCount] = address;
+    p_machine->cellValue[p_machine->cellCount++] = value;
+}
+
+static void HSO_step(HSO_machine* p_machine, HackInstruction word) {
+    uint16_t comp = HI_COMP(word);
+    uint16_t dest = HI_DEST(word);
+    uint16_t address = p_machine->a & HSO_RAM_MASK;
+    uint16_t y =
+        (comp & HI_COMP_M) ? HSO_read(p_machine, address) : p_machine->a;
+    uint16_t out = HI_alu(comp, p_machine->d, y);
+    if (dest & HI_DEST_M) {
+        HSO_write(p_machine, address, out);
+    }
+    if (dest & HI_DEST_A) {
+        p_machine->a = out;
+    }
+    if (dest & HI_DEST_D) {
+        p_machine->d = out;
+    }
+}
+
+static void HSO_run(HSO_machine* p_machine, const HackInstruction* words,
+                    uint32_t length) {
+    for (uint32_t i = 0; i < length; ++i) {
+        HSO_step(p_machine, words[i]);
+    }
+}
+
+// Returns true if both machines have the same registers and memory
+static bool HSO_same_state(const HSO_machine* p_first,
+                           const HSO_machine* p_second) {
+    if (p_first->a != p_second->a || p_first->d != p_second->d) {
+        return false;
+    }
+    for (int i = 0; i < p_first->cellCount; ++i) {
+        if (HSO_read(p_second, p_first->cellAddress[i]) !=
+            p_first->cellValue[i]) {
+            return false;
+        }
+    }
+    for (int i = 0; i < p_second->cellCount; ++i) {
+        if (HSO_read(p_first, p_second->cellAddress[i]) !=
+            p_second->cellValue[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns true if candidate turns every test in the matching expected state
+static bool HSO_equivalent(const HSO_machine* tests,
+                           const HSO_machine* expected, int testCount,
+                           const HackInstruction* candidate,
+                           uint32_t length) {
+    for (int i = 0; i < testCount; ++i) {
+        HSO_machine actual = tests[i];
+        HSO_run(&actual, candidate, length);
+        if (!HSO_same_state(expected + i, &actual)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Runs the window on every test
+static void HSO_expect(const HSO_machine* tests, HSO_machine* expected,
+                       int testCount, const HSO_window* p_window) {
+    for (int i = 0; i < testCount; ++i) {
+        expected[i] = tests[i];
+        HSO_run(expected + i, p_window->words, p_window->length);
+    }
+}
+
+static void HSO_init_tests() {
+    static const uint16_t edges[] = {0, 1, 0xFFFF, 0x7FFF, 0x8000, 2};
+    const int edgeCount = sizeof(edges) / sizeof(edges[0]);
+    uint32_t random = 2463534242u;
+    for (int i = 0; i < HSO_QUICK_TESTS; ++i) {
+        HSO_machine* p_test = quickTests + i;
+        memset(p_test, 0, sizeof(HSO_machine));
+        p_test->seed = HSO_random(&random);
+        if (i < edgeCount * edgeCount) {
+            p_test->a = edges[i / edgeCount];
+            p_test->d = edges[i % edgeCount];
+        } else {
+            p_test->a = HSO_random(&random);
+            p_test->d = (i & 1) ? p_test->a : HSO_random(&random);
+        }
+    }
+    for (int i = 0; i < HSO_FULL_TESTS; ++i) {
+        HSO_machine* p_test = fullTests + i;
+        memset(p_test, 0, sizeof(HSO_machine));
+        p_test->seed = HSO_random(&random);
+        p_test->a = HSO_random(&random);
+        // A few states with A = D, or close to it
+        p_test->d = (i % 16 == 0) ? (uint16_t)(p_test->a + (i / 16) % 3 - 1)
+                                  : (uint16_t)HSO_random(&random);
+    }
+}
+
+static void HSO_init_alphabet() {
+    int count = 0;
+    for (size_t i = 0; i < HSO_DEST_COUNT; ++i) {
+        for (size_t j = 0; j < HSO_COMP_COUNT; ++j) {
+            HSO_letter* p_letter = alphabet + count++;
+            snprintf(p_letter->text, sizeof(p_letter->text), "%s=%s",
+                     HSO_DESTS[i], HSO_COMPS[j]);
+            HackSlice dest = {HSO_DESTS[i], strlen(HSO_DESTS[i])};
+            HackSlice comp = {HSO_COMPS[j], strlen(HSO_COMPS[j])};
+            HackSlice jump = {NULL, 0};
+            set_CInstruction(&p_letter->word, &dest, &comp, &jump);
+        }
+    }
+}
+
+// Prints the instruction word in the syntax of the assembler
+static void HSO_print_word(HackInstruction word) {
+    for (size_t i = 0; i < HSO_ALPHABET_SIZE; ++i) {
+        if (alphabet[i].word == word) {
+            printf("%s", alphabet[i].text);
+            return;
+        }
+    }
+    // No destination : only the comp
+    for (size_t j = 0; j < HSO_COMP_COUNT; ++j) {
+        if (alphabet[j].word ==
+            (word | (HI_DEST_M << HI_DEST_SHIFT))) {
+            printf("%s", HSO_COMPS[j]);
+            return;
+        }
+    }
+}
+
+static void HSO_print_rule(const HSO_window* p_window,
+                           const HackInstruction* replacement,
+                           uint32_t length) {
+    for (uint32_t i = 0; i < p_window->length; ++i) {
+        printf(i == 0 ? "" : " / ");
+        HSO_print_word(p_window->words[i]);
+    }
+    printf(" =>");
+    for (uint32_t i = 0; i < length; ++i) {
+        printf(i == 0 ? " " : " / ");
+        HSO_print_word(replacement[i]);
+    }
+    printf("\n");
+}
+
+// Tries every sequence of length letters, from position on
+static bool HSO_search(const HSO_window* p_window, HackInstruction* candidate,
+                       uint32_t position, uint32_t length) {
+    if (position == length) {
+        if (!HSO_equivalent(quickTests, quickExpected, HSO_QUICK_TESTS,
+                            candidate, length)) {
+            return false;
+        }
+        HSO_expect(fullTests, fullExpected, HSO_FULL_TESTS, p_window);
+        return HSO_equivalent(fullTests, fullExpected, HSO_FULL_TESTS,
+                              candidate, length);
+    }
+    for (size_t i = 0; i < HSO_ALPHABET_SIZE; ++i) {
+        candidate[position] = alphabet[i].word;
+        if (HSO_search(p_window, candidate, position + 1, length)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void HSO_push_window(HSO_windows* p_windows, const HackInstruction* words,
+                            uint32_t length) {
+    if (p_windows->size == p_windows->capacity) {
+        p_windows->capacity =
+            p_windows->capacity == 0 ? 256 : 2 * p_windows->capacity;
+        HSO_window* newWindows = realloc(
+            p_windows->windows, p_windows->capacity * sizeof(HSO_window));
+        if (newWindows == NULL) {
+            fprintf(stderr, "Could not grow the windows array\n");
+            exit(1);
+        }
+        p_windows->windows = newWindows;
+    }
+    HSO_window* p_window = p_windows->windows + p_windows->size++;
+    memset(p_window, 0, sizeof(HSO_window));
+    memcpy(p_window->words, words, length * sizeof(HackInstruction));
+    p_window->length = length;
+}
+
+// Adds every window of the rows of C instructions of the file
+static bool HSO_read_windows(HSO_windows* p_windows, const char* filename) {
+    FILE* stream = fopen(filename, "r");
+    HackSource source;
+    if (stream == NULL || !HS_load(&source, stream)) {
+        fprintf(stderr, "Could not read %s\n", filename);
+        if (stream != NULL) {
+            fclose(stream);
+        }
+        return false;
+    }
+    fclose(stream);
+
+    HackInstruction row[HR_MAX_WINDOW];
+    uint32_t rowLength = 0;
+    HackLexer lexer;
+    HL_init(&lexer, source.data, source.length);
+    HackLine line;
+    while (HL_next_line(&lexer, &line)) {
+        HackInstruction word;
+        if (line.type != HL_C_INSTRUCTION ||
+            !set_CInstruction(&word, &line.dest, &line.comp, &line.jump) ||
+            HI_JUMP(word) != 0) {
+            rowLength = 0;
+            continue;
+        }
+        // Keep the last HR_MAX_WINDOW instructions of the row
+        if (rowLength == HR_MAX_WINDOW) {
+            memmove(row, row + 1, (HR_MAX_WINDOW - 1) * sizeof(word));
+            rowLength--;
+        }
+        row[rowLength++] = word;
+        // Windows ending on this instruction
+        for (uint32_t length = 2; length <= rowLength; ++length) {
+            HSO_push_window(p_windows, row + rowLength - length, length);
+        }
+    }
+    HS_release(&source);
+    return true;
+}
+
+static int HSO_compare_windows(const void* a, const void* b) {
+    const HSO_window* windowA = a;
+    const HSO_window* windowB = b;
+    if (windowA->length != windowB->length) {
+        return windowA->length < windowB->length ? -1 : 1;
+    }
+    return memcmp(windowA->words, windowB->words,
+                  windowA->length * sizeof(HackInstruction));
+}
+
+// Returns the saving of the window made of the length words, which is in
+// the sorted windows
+static uint32_t HSO_saving_of(const HSO_windows* p_windows, uint32_t count,
+                              const HackInstruction* words, uint32_t length) {
+    HSO_window key;
+    memset(&key, 0, sizeof(HSO_window));
+    memcpy(key.words, words, length * sizeof(HackInstruction));
+    key.length = length;
+    const HSO_window* p_found = bsearch(&key, p_windows->windows, count,
+                                        sizeof(HSO_window),
+                                        HSO_compare_windows);
+    return p_found == NULL ? 0 : p_found->saving;
+}
+
+// Most words saved inside the window by the rules of shorter windows that
+// do not overlap
+static uint32_t HSO_inner_saving(const HSO_windows* p_windows, uint32_t count,
+                                 const HSO_window* p_window) {
+    // best[j] : most words saved in the first j instructions
+    uint32_t best[HR_MAX_WINDOW + 1] = {0};
+    for (uint32_t j = 2; j <= p_window->length; ++j) {
+        best[j] = best[j - 1];
+        for (uint32_t i = 0; i + 2 <= j; ++i) {
+            if (j - i == p_window->length) {
+                continue;
+            }
+            uint32_t saving = best[i] + HSO_saving_of(p_windows, count,
+                                                      p_window->words + i,
+                                                      j - i);
+            if (saving > best[j]) {
+                best[j] = saving;
+            }
+        }
+    }
+    return best[p_window->length];
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printf("HackSuperoptimizer : finds shorter C instruction sequences\n");
+        printf("Usage : HackSuperoptimizer file.asm... > rules\n");
+        printf("The rules are read by HackAssembler --rules=FILE\n");
+        return 1;
+    }
+    HSO_init_alphabet();
+    HSO_init_tests();
+
+    HSO_windows windows = {NULL, 0, 0};
+    for (int i = 1; i < argc; ++i) {
+        if (!HSO_read_windows(&windows, argv[i])) {
+            free(windows.windows);
+            return 1;
+        }
+    }
+    // Shortest windows first, without duplicates
+    qsort(windows.windows, windows.size, sizeof(HSO_window),
+          HSO_compare_windows);
+    uint32_t unique = 0;
+    for (uint32_t i = 0; i < windows.size; ++i) {
+        if (unique == 0 || HSO_compare_windows(windows.windows + unique - 1,
+                                               windows.windows + i) != 0) {
+            windows.windows[unique++] = windows.windows[i];
+        }
+    }
+    fprintf(stderr, "Searching %u windows\n", unique);
+
+    printf("// Generated by HackSuperoptimizer\n");
+    uint32_t found = 0;
+    for (uint32_t i = 0; i < unique; ++i) {
+        HSO_window* p_window = windows.windows + i;
+        // A rule is only written if it saves more than the rules of the
+        // shorter windows, which the assembler applies anyway
+        uint32_t innerSaving = HSO_inner_saving(&windows, unique, p_window);
+        p_window->saving = 0;
+        if (innerSaving + 1 >= p_window->length) {
+            continue;
+        }
+        HackInstruction candidate[HSO_MAX_SEARCH_LENGTH];
+        uint32_t maxLength = p_window->length - 1 - innerSaving;
+        if (maxLength > HSO_MAX_SEARCH_LENGTH) {
+            maxLength = HSO_MAX_SEARCH_LENGTH;
+        }
+        HSO_expect(quickTests, quickExpected, HSO_QUICK_TESTS, p_window);
+        for (uint32_t length = 0; length <= maxLength; ++length) {
+            if (HSO_search(p_window, candidate, 0, length)) {
+                HSO_print_rule(p_window, candidate, length);
+                p_window->saving = p_window->length - length;
+                found++;
+                break;
+            }
+        }
+    }
+    fprintf(stderr, "Found %u rules\n", found);
+    free(windows.windows);
+    return 0;
+}
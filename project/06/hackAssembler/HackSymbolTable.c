@@ -1,79 +1,43 @@
 #include "HackSymbolTable.h"
 
-void STP_push_back(ST_pairs* list, ST_pair* element) {
-    element->next = NULL;
-    if (*list == NULL) {
-        *list = element;
-        /* fprintf(stderr, "%s, %d : ajoute \n", element->key, element->value);
-         */
-        return;
-    }
-    ST_pairs temp = *list;
-    while (temp->next != NULL) {
-        temp = temp->next;
-    }
-    temp->next = element;
-    /* fprintf(stderr, "%s, %d : ajoute \n", element->key, element->value); */
-    return;
-}
-
-void STP_pop_front(ST_pairs* list) {
-    if (*list == NULL) {
-        return;
+void STA_init(ST_arena* p_arena) { p_arena->head = NULL; }
+
+const char* STA_intern(ST_arena* p_arena, const char* str, size_t length) {
+    ST_arenaBlock* block = p_arena->head;
+    if (block == NULL || block->size - block->used < length + 1) {
+        // Keys longer than a block get a block of their own
+        size_t blockSize = length + 1 > ST_ARENA_BLOCKSIZE
+                               ? length + 1
+                               : ST_ARENA_BLOCKSIZE;
+        block = malloc(sizeof(ST_arenaBlock) + blockSize);
+        if (block == NULL) {
+            fprintf(stderr, "Could not grow the symbol table arena\n");
+            exit(1);
+        }
+        block->used = 0;
+        block->size = blockSize;
+        block->next = p_arena->head;
+        p_arena->head = block;
     }
-    ST_pairs prev = *list;
-    *list = (*list)->next;
-    free(prev->key);
-    free(prev);
-    return;
+    char* interned = block->data + block->used;
+    memcpy(interned, str, length);
+    interned[length] = '\0';
+    block->used += length + 1;
+    return interned;
 }
 
-ST_pair* STP_front(ST_pairs* list) { return *list; }
-
-ST_pair* STP_back(ST_pairs* list) {
-    if (*list == NULL) {
-        return NULL;
-    }
-    ST_pairs temp = *list;
-    while (temp->next != NULL) {
-        temp = temp->next;
+void STA_release(ST_arena* p_arena) {
+    while (p_arena->head != NULL) {
+        ST_arenaBlock* next = p_arena->head->next;
+        free(p_arena->head);
+        p_arena->head = next;
     }
-    return temp;
 }
 
 void ST_print(ST_pair* p_pair) {
     fprintf(stderr, "%s, %d\n", p_pair->key, p_pair->value);
 }
 
-void STP_print_all_elements(ST_pairs* p_list) {
-    ST_pairs temp = *p_list;
-    if (temp == NULL) {
-        fprintf(stderr, "NULL\n");
-    } else {
-        while (temp != NULL) {
-            ST_print(temp);
-            temp = temp->next;
-        }
-    }
-}
-
-void STP_delete_list(ST_pairs* list) {
-    while (*list != NULL) {
-        STP_pop_front(list);
-    }
-}
-
-int64_t STP_check_for_key(ST_pairs* list, const char* wantedKey) {
-    ST_pairs iter = *list;
-    while (iter != NULL) {
-        if (strcmp(iter->key, wantedKey) == 0) {
-            return iter->value;
-        }
-        iter = iter->next;
-    }
-    return KEY_NOT_FOUND;
-}
-
 // The hash is done using djb2 algorithm
 // http://www.cse.yorku.ca/~oz/hash.html
 /* unsigned long ST_hash(const char* str) { */
@@ -87,40 +51,108 @@ int64_t STP_check_for_key(ST_pairs* list, const char* wantedKey) {
 /* } */
 
 // This hash method is sdbm
-unsigned long ST_hash(const char* str) {
-    unsigned long hash = 0;
-    int c;
+uint32_t ST_hash(const char* str, size_t length) {
+    uint32_t hash = 0;
 
-    while ((c = *(str++))) hash = c + (hash << 6) + (hash << 16) - hash;
+    for (size_t i = 0; i < length; ++i) {
+        int c = str[i];
+        hash = c + (hash << 6) + (hash << 16) - hash;
+    }
+
+    return hash;
+}
 
-    return (hash % HASHSIZE);
+// Returns the slot holding the key, or the empty slot where it belongs
+static ST_pair* ST_find_slot(HackSymbolTable* p_table, const char* key,
+                             size_t length, uint32_t hash) {
+    uint32_t mask = p_table->capacity - 1;
+    uint32_t index = hash & mask;
+    while (p_table->slots[index].key != NULL) {
+        ST_pair* slot = p_table->slots + index;
+        if (slot->hash == hash && slot->keyLength == length &&
+            memcmp(slot->key, key, length) == 0) {
+            return slot;
+        }
+        index = (index + 1) & mask;
+    }
+    return p_table->slots + index;
+}
+
+// Doubles the capacity of the table and reinserts every pair
+// Keys stay in the arena, only the slots are moved
+static void ST_grow(HackSymbolTable* p_table) {
+    ST_pair* oldSlots = p_table->slots;
+    uint32_t oldCapacity = p_table->capacity;
+    p_table->capacity *= 2;
+    p_table->slots = calloc(p_table->capacity, sizeof(ST_pair));
+    if (p_table->slots == NULL) {
+        fprintf(stderr, "Could not grow the symbol table to %u\n",
+                p_table->capacity);
+        exit(1);
+    }
+    for (uint32_t i = 0; i < oldCapacity; ++i) {
+        if (oldSlots[i].key != NULL) {
+            *ST_find_slot(p_table, oldSlots[i].key, oldSlots[i].keyLength,
+                          oldSlots[i].hash) = oldSlots[i];
+        }
+    }
+    free(oldSlots);
 }
 
 int64_t ST_check_for_key(HackSymbolTable* p_table, const char* wantedKey) {
-    unsigned long hashValue = ST_hash(wantedKey);
-    return STP_check_for_key(&p_table->hash_buckets[hashValue], wantedKey);
+    HackSlice slice = {wantedKey, strlen(wantedKey)};
+    return ST_check_for_slice(p_table, &slice);
+}
+
+int64_t ST_check_for_slice(HackSymbolTable* p_table,
+                           const HackSlice* wantedKey) {
+    uint32_t hash = ST_hash(wantedKey->start, wantedKey->length);
+    ST_pair* slot =
+        ST_find_slot(p_table, wantedKey->start, wantedKey->length, hash);
+    if (slot->key == NULL) {
+        return KEY_NOT_FOUND;
+    }
+    return slot->value;
 }
 
 void ST_add_key(HackSymbolTable* p_table, const char* newKey,
                 const uint32_t value) {
-    unsigned long hashValue = ST_hash(newKey);
-    ST_pair* newPair = malloc(sizeof(ST_pair));
-    char* newPairKey = strdup(newKey);
-    newPair->key = newPairKey;
-    newPair->value = value;
-    STP_push_back(&(p_table->hash_buckets[hashValue]), newPair);
+    HackSlice slice = {newKey, strlen(newKey)};
+    ST_add_slice(p_table, &slice, value);
 }
 
-void ST_delete_all_entries(HackSymbolTable* p_table) {
-    for (int i = 0; i < HASHSIZE; ++i) {
-        STP_delete_list(&p_table->hash_buckets[i]);
+void ST_add_slice(HackSymbolTable* p_table, const HackSlice* newKey,
+                  const uint32_t value) {
+    // Keep the load factor under 1/2 so that probe sequences stay short
+    if (2 * (p_table->size + 1) > p_table->capacity) {
+        ST_grow(p_table);
+    }
+    uint32_t hash = ST_hash(newKey->start, newKey->length);
+    ST_pair* slot =
+        ST_find_slot(p_table, newKey->start, newKey->length, hash);
+    if (slot->key != NULL) {
+        return;
     }
+    slot->key = STA_intern(&p_table->arena, newKey->start, newKey->length);
+    slot->keyLength = newKey->length;
+    slot->hash = hash;
+    slot->value = value;
+    p_table->size++;
+}
+
+void ST_delete_all_entries(HackSymbolTable* p_table) {
+    free(p_table->slots);
+    p_table->slots = NULL;
+    p_table->capacity = 0;
+    p_table->size = 0;
+    STA_release(&p_table->arena);
 }
 
 void ST_initialise(HackSymbolTable* p_table) {
-    for (int i = 0; i < HASHSIZE; ++i) {
-        p_table->hash_buckets[i] = NULL;
-    }
+    p_table->capacity = ST_INITIAL_CAPACITY;
+    p_table->size = 0;
+    p_table->slots = calloc(p_table->capacity, sizeof(ST_pair));
+    STA_init(&p_table->arena);
     ST_add_key(p_table, "R0", 0);
     ST_add_key(p_table, "R1", 1);
     ST_add_key(p_table, "R2", 2);
@@ -150,7 +182,9 @@ void ST_initialise(HackSymbolTable* p_table) {
 }
 
 void ST_print_table(HackSymbolTable* p_table) {
-    for (int i = 0; i < HASHSIZE; ++i) {
-        STP_print_all_elements(&(p_table->hash_buckets[i]));
+    for (uint32_t i = 0; i < p_table->capacity; ++i) {
+        if (p_table->slots[i].key != NULL) {
+            ST_print(p_table->slots + i);
+        }
     }
 }
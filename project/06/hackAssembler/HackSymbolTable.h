@@ -1,14 +1,14 @@
 // Implementation of a hash table for the symbol table of the
 // assembler
-// Collision handling is done using the bucket implementation of the table.
+// Collision handling is done with open addressing (linear probing), and the
+// table doubles its capacity when it gets half full.
+// The keys are interned in a bump arena owned by the table, so inserting a
+// key never allocates on its own and the whole table is freed at once.
 #ifndef _HACKSYMBOLTABLE_H_
 #define _HACKSYMBOLTABLE_H_
 
-#ifndef __STDC_WANT_LIB_EXT2__
-#define __STDC_WANT_LIB_EXT2__ 1
-#endif  // __STDC_WANT_LIB_EXT2__
-
-#define HASHSIZE 33
+#define ST_INITIAL_CAPACITY 64
+#define ST_ARENA_BLOCKSIZE 65536
 #define KEY_NOT_FOUND -9999999999
 
 #include <stdbool.h>
@@ -17,57 +17,73 @@
 #include <stdlib.h>
 #include <string.h>
 
-// Linked list of key-value pairs
+#include "HackTools.h"
+
+// Block of the arena, blocks are chained from the newest to the oldest
+typedef struct ST_arenaBlock ST_arenaBlock;
+struct ST_arenaBlock {
+    ST_arenaBlock* next;
+    size_t used;
+    size_t size;
+    char data[];
+};
+
+// Bump allocator for the keys
+typedef struct ST_arena ST_arena;
+struct ST_arena {
+    ST_arenaBlock* head;
+};
+
+void STA_init(ST_arena* p_arena);
+// Copies length chars of str in the arena and null-terminates them
+const char* STA_intern(ST_arena* p_arena, const char* str, size_t length);
+void STA_release(ST_arena* p_arena);
+
+// Slot of the table, a slot is empty if key is NULL
+// The hash is cached so that probing and resizing don't hash keys again
 typedef struct ST_pair ST_pair;
 struct ST_pair {
-    ST_pair* next;
-    char* key;
+    const char* key;
+    uint32_t keyLength;
+    uint32_t hash;
     uint32_t value;
 };
 // Print method, to stderr for debug
 void ST_print(ST_pair* p_pair);
 
-// Linked list typedef
-typedef struct ST_pair* ST_pairs;
-// Linked list interface
-void STP_push_back(ST_pairs* list, ST_pair* element);
-void STP_pop_front(ST_pairs* list);
-ST_pair* STP_front(ST_pairs* list);
-ST_pair* STP_back(ST_pairs* list);
-void STP_print_all_elements(ST_pairs* p_list);
-void STP_delete_list(ST_pairs* list);
-// Check if a given key is in the linked list
-// This method's output is the value if the key is found,
-// or the negative preprocessor constant KEY_NOT_FOUND otherwise.
-int64_t STP_check_for_key(ST_pairs* list, const char* wantedKey);
-
 // Struct for the hash table
 typedef struct HackSymbolTable HackSymbolTable;
 struct HackSymbolTable {
-    // This is an array of linked lists
-    ST_pairs hash_buckets[HASHSIZE];
+    // Array of capacity slots, capacity is a power of 2
+    ST_pair* slots;
+    uint32_t capacity;
+    uint32_t size;
+    ST_arena arena;
 };
 
-// Hash function that takes a string and gives an integer in
-//   [0..HASHSIZE-1]
-// It is this method's responsibility to give a valid hash number in
-// the interval
-unsigned long ST_hash(const char* key);
+// Hash function that takes length chars of a string
+// The caller masks the hash to the capacity of the table
+uint32_t ST_hash(const char* key, size_t length);
 
 // Initialisation of the table
-// Put null pointers in the array and populate the 'built-in' assembly
-// keywords
+// Allocate the slots and populate the 'built-in' assembly keywords
 void ST_initialise(HackSymbolTable* p_table);
 // Check if key is in table.
 // To avoid multiple passes, the method should either :
 // - directly give the value associated with the key in the table if it exists.
 // - return the negative preprocessor constant KEY_NOT_FOUND otherwise.
 int64_t ST_check_for_key(HackSymbolTable* p_table, const char* wantedKey);
+// Same as ST_check_for_key, for a key that is a slice of the source
+int64_t ST_check_for_slice(HackSymbolTable* p_table, const HackSlice* wantedKey);
 // Adds a new pair in the hash table
-// It is the caller's responsibility to check that the key doesn't already
-// exists in the table
+// If the key already exists, the table is left unchanged, so the first
+// value given to a key is kept
 void ST_add_key(HackSymbolTable* p_table, const char* newKey,
                 const uint32_t value);
+// Same as ST_add_key, for a key that is a slice of the source
+// The key is copied in the arena of the table
+void ST_add_slice(HackSymbolTable* p_table, const HackSlice* newKey,
+                  const uint32_t value);
 
 // Prints the table on stderr, solely for debug purposes
 void ST_print_table(HackSymbolTable* p_table);
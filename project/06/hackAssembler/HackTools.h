@@ -2,8 +2,16 @@
 #define HACKTOOLS_H_
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+// View on a part of the source buffer, which is NOT null-terminated
+typedef struct HackSlice HackSlice;
+struct HackSlice {
+    const char* start;
+    size_t length;
+};
+
 void getBin(int16_t num, char* str);
 void tobinstr(int16_t value, int bitsCount, char* output);
 void tobin(int16_t value, int bitscount, bool* output);
@@ -0,0 +1,15 @@
+// call CALLEENAME I
+// R13 = callee, R14 = argument count, D = return address
+@CALLEENAME
+D=A
+@R13
+M=D
+@I
+D=A
+@R14
+M=D
+@FUNCTIONNAME$ret.RET_ID
+D=A
+@VM$call
+0;JMP
+(FUNCTIONNAME$ret.RET_ID)
@@ -0,0 +1,6 @@
+// eq
+@RET_EQ.J
+D=A
+@VM$eq
+0;JMP
+(RET_EQ.J)
@@ -0,0 +1,6 @@
+// gt
+@RET_GT.J
+D=A
+@VM$gt
+0;JMP
+(RET_GT.J)
@@ -0,0 +1,6 @@
+// lt
+@RET_LT.J
+D=A
+@VM$lt
+0;JMP
+(RET_LT.J)
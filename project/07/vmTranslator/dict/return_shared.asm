@@ -0,0 +1,3 @@
+// return
+@VM$return
+0;JMP
@@ -0,0 +1,154 @@
+// shared call, return and comparison routines, jumped over
+@VM$end
+0;JMP
+// call : D = return address, R13 = callee, R14 = argument count
+(VM$call)
+// push return address
+@SP
+AM=M+1
+A=A-1
+M=D
+// push the rest of caller frame
+@LCL
+D=M
+@SP
+AM=M+1
+A=A-1
+M=D
+@ARG
+D=M
+@SP
+AM=M+1
+A=A-1
+M=D
+@THIS
+D=M
+@SP
+AM=M+1
+A=A-1
+M=D
+@THAT
+D=M
+@SP
+AM=M+1
+A=A-1
+M=D
+// set ARG = SP - 5 - R14
+@R14
+D=M
+@5
+D=D+A
+@SP
+D=M-D
+@ARG
+M=D
+// LCL = SP
+@SP
+D=M
+@LCL
+M=D
+@R13
+A=M
+0;JMP
+(VM$return)
+// Register returnAddress and endFrame
+@LCL
+D=M
+@R13 // endFrame
+M=D
+@5
+D=D-A
+A=D
+D=M
+@R14 // retAddr
+M=D
+// pop arg 0
+@SP
+M=M-1
+A=M
+D=M
+@ARG
+A=M
+M=D
+// SP = *ARG+1
+@ARG
+D=M+1
+@SP
+M=D
+// Restore caller frame
+@R13
+M=M-1
+A=M
+D=M
+@THAT
+M=D
+@R13
+M=M-1
+A=M
+D=M
+@THIS
+M=D
+@R13
+M=M-1
+A=M
+D=M
+@ARG
+M=D
+@R13
+M=M-1
+A=M
+D=M
+@LCL
+M=D
+// Jump to the saved return address
+@R14
+A=M
+0;JMP
+// gt, lt, eq : D = return address, saved in R15
+// x - y is computed and x is set to true, then to false if the test fails
+(VM$gt)
+@R15
+M=D
+@SP
+AM=M-1
+D=M
+A=A-1
+D=M-D
+M=-1
+@VM$true
+D;JGT
+@VM$false
+0;JMP
+(VM$lt)
+@R15
+M=D
+@SP
+AM=M-1
+D=M
+A=A-1
+D=M-D
+M=-1
+@VM$true
+D;JLT
+@VM$false
+0;JMP
+(VM$eq)
+@R15
+M=D
+@SP
+AM=M-1
+D=M
+A=A-1
+D=M-D
+M=-1
+@VM$true
+D;JEQ
+(VM$false)
+@SP
+A=M-1
+M=0
+(VM$true)
+@R15
+A=M
+0;JMP
+(VM$end)
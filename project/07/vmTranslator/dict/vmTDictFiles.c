@@ -320,3 +320,150 @@ const char init_asm[] = {
     0x62, 0x6f, 0x6f, 0x74, 0x73, 0x74, 0x72, 0x61, 0x70, 0x24, 0x72, 0x65,
     0x74, 0x2e, 0x30, 0x29, 0x0a, 0x00};
 unsigned int init_asm_len = 413;
+const char call_shared_asm[] = {
+    0x2f, 0x2f, 0x20, 0x63, 0x61, 0x6c, 0x6c, 0x20, 0x43, 0x41, 0x4c, 0x4c,
+    0x45, 0x45, 0x4e, 0x41, 0x4d, 0x45, 0x20, 0x49, 0x0a, 0x2f, 0x2f, 0x20,
+    0x52, 0x31, 0x33, 0x20, 0x3d, 0x20, 0x63, 0x61, 0x6c, 0x6c, 0x65, 0x65,
+    0x2c, 0x20, 0x52, 0x31, 0x34, 0x20, 0x3d, 0x20, 0x61, 0x72, 0x67, 0x75,
+    0x6d, 0x65, 0x6e, 0x74, 0x20, 0x63, 0x6f, 0x75, 0x6e, 0x74, 0x2c, 0x20,
+    0x44, 0x20, 0x3d, 0x20, 0x72, 0x65, 0x74, 0x75, 0x72, 0x6e, 0x20, 0x61,
+    0x64, 0x64, 0x72, 0x65, 0x73, 0x73, 0x0a, 0x40, 0x43, 0x41, 0x4c, 0x4c,
+    0x45, 0x45, 0x4e, 0x41, 0x4d, 0x45, 0x0a, 0x44, 0x3d, 0x41, 0x0a, 0x40,
+    0x52, 0x31, 0x33, 0x0a, 0x4d, 0x3d, 0x44, 0x0a, 0x40, 0x49, 0x0a, 0x44,
+    0x3d, 0x41, 0x0a, 0x40, 0x52, 0x31, 0x34, 0x0a, 0x4d, 0x3d, 0x44, 0x0a,
+    0x40, 0x46, 0x55, 0x4e, 0x43, 0x54, 0x49, 0x4f, 0x4e, 0x4e, 0x41, 0x4d,
+    0x45, 0x24, 0x72, 0x65, 0x74, 0x2e, 0x52, 0x45, 0x54, 0x5f, 0x49, 0x44,
+    0x0a, 0x44, 0x3d, 0x41, 0x0a, 0x40, 0x56, 0x4d, 0x24, 0x63, 0x61, 0x6c,
+    0x6c, 0x0a, 0x30, 0x3b, 0x4a, 0x4d, 0x50, 0x0a, 0x28, 0x46, 0x55, 0x4e,
+    0x43, 0x54, 0x49, 0x4f, 0x4e, 0x4e, 0x41, 0x4d, 0x45, 0x24, 0x72, 0x65,
+    0x74, 0x2e, 0x52, 0x45, 0x54, 0x5f, 0x49, 0x44, 0x29, 0x0a, 0x00};
+unsigned int call_shared_asm_len = 190;
+const char return_shared_asm[] = {
+    0x2f, 0x2f, 0x20, 0x72, 0x65, 0x74, 0x75, 0x72, 0x6e, 0x0a, 0x40, 0x56,
+    0x4d, 0x24, 0x72, 0x65, 0x74, 0x75, 0x72, 0x6e, 0x0a, 0x30, 0x3b, 0x4a,
+    0x4d, 0x50, 0x0a, 0x00};
+unsigned int return_shared_asm_len = 27;
+const char eq_shared_asm[] = {
+    0x2f, 0x2f, 0x20, 0x65, 0x71, 0x0a, 0x40, 0x52, 0x45, 0x54, 0x5f, 0x45,
+    0x51, 0x2e, 0x4a, 0x0a, 0x44, 0x3d, 0x41, 0x0a, 0x40, 0x56, 0x4d, 0x24,
+    0x65, 0x71, 0x0a, 0x30, 0x3b, 0x4a, 0x4d, 0x50, 0x0a, 0x28, 0x52, 0x45,
+    0x54, 0x5f, 0x45, 0x51, 0x2e, 0x4a, 0x29, 0x0a, 0x00};
+unsigned int eq_shared_asm_len = 44;
+const char gt_shared_asm[] = {
+    0x2f, 0x2f, 0x20, 0x67, 0x74, 0x0a, 0x40, 0x52, 0x45, 0x54, 0x5f, 0x47,
+    0x54, 0x2e, 0x4a, 0x0a, 0x44, 0x3d, 0x41, 0x0a, 0x40, 0x56, 0x4d, 0x24,
+    0x67, 0x74, 0x0a, 0x30, 0x3b, 0x4a, 0x4d, 0x50, 0x0a, 0x28, 0x52, 0x45,
+    0x54, 0x5f, 0x47, 0x54, 0x2e, 0x4a, 0x29, 0x0a, 0x00};
+unsigned int gt_shared_asm_len = 44;
+const char lt_shared_asm[] = {
+    0x2f, 0x2f, 0x20, 0x6c, 0x74, 0x0a, 0x40, 0x52, 0x45, 0x54, 0x5f, 0x4c,
+    0x54, 0x2e, 0x4a, 0x0a, 0x44, 0x3d, 0x41, 0x0a, 0x40, 0x56, 0x4d, 0x24,
+    0x6c, 0x74, 0x0a, 0x30, 0x3b, 0x4a, 0x4d, 0x50, 0x0a, 0x28, 0x52, 0x45,
+    0x54, 0x5f, 0x4c, 0x54, 0x2e, 0x4a, 0x29, 0x0a, 0x00};
+unsigned int lt_shared_asm_len = 44;
+const char shared_asm[] = {
+    0x2f, 0x2f, 0x20, 0x73, 0x68, 0x61, 0x72, 0x65, 0x64, 0x20, 0x63, 0x61,
+    0x6c, 0x6c, 0x2c, 0x20, 0x72, 0x65, 0x74, 0x75, 0x72, 0x6e, 0x20, 0x61,
+    0x6e, 0x64, 0x20, 0x63, 0x6f, 0x6d, 0x70, 0x61, 0x72, 0x69, 0x73, 0x6f,
+    0x6e, 0x20, 0x72, 0x6f, 0x75, 0x74, 0x69, 0x6e, 0x65, 0x73, 0x2c, 0x20,
+    0x6a, 0x75, 0x6d, 0x70, 0x65, 0x64, 0x20, 0x6f, 0x76, 0x65, 0x72, 0x0a,
+    0x40, 0x56, 0x4d, 0x24, 0x65, 0x6e, 0x64, 0x0a, 0x30, 0x3b, 0x4a, 0x4d,
+    0x50, 0x0a, 0x2f, 0x2f, 0x20, 0x63, 0x61, 0x6c, 0x6c, 0x20, 0x3a, 0x20,
+    0x44, 0x20, 0x3d, 0x20, 0x72, 0x65, 0x74, 0x75, 0x72, 0x6e, 0x20, 0x61,
+    0x64, 0x64, 0x72, 0x65, 0x73, 0x73, 0x2c, 0x20, 0x52, 0x31, 0x33, 0x20,
+    0x3d, 0x20, 0x63, 0x61, 0x6c, 0x6c, 0x65, 0x65, 0x2c, 0x20, 0x52, 0x31,
+    0x34, 0x20, 0x3d, 0x20, 0x61, 0x72, 0x67, 0x75, 0x6d, 0x65, 0x6e, 0x74,
+    0x20, 0x63, 0x6f, 0x75, 0x6e, 0x74, 0x0a, 0x28, 0x56, 0x4d, 0x24, 0x63,
+    0x61, 0x6c, 0x6c, 0x29, 0x0a, 0x2f, 0x2f, 0x20, 0x70, 0x75, 0x73, 0x68,
+    0x20, 0x72, 0x65, 0x74, 0x75, 0x72, 0x6e, 0x20, 0x61, 0x64, 0x64, 0x72,
+    0x65, 0x73, 0x73, 0x0a, 0x40, 0x53, 0x50, 0x0a, 0x41, 0x4d, 0x3d, 0x4d,
+    0x2b, 0x31, 0x0a, 0x41, 0x3d, 0x41, 0x2d, 0x31, 0x0a, 0x4d, 0x3d, 0x44,
+    0x0a, 0x2f, 0x2f, 0x20, 0x70, 0x75, 0x73, 0x68, 0x20, 0x74, 0x68, 0x65,
+    0x20, 0x72, 0x65, 0x73, 0x74, 0x20, 0x6f, 0x66, 0x20, 0x63, 0x61, 0x6c,
+    0x6c, 0x65, 0x72, 0x20, 0x66, 0x72, 0x61, 0x6d, 0x65, 0x0a, 0x40, 0x4c,
+    0x43, 0x4c, 0x0a, 0x44, 0x3d, 0x4d, 0x0a, 0x40, 0x53, 0x50, 0x0a, 0x41,
+    0x4d, 0x3d, 0x4d, 0x2b, 0x31, 0x0a, 0x41, 0x3d, 0x41, 0x2d, 0x31, 0x0a,
+    0x4d, 0x3d, 0x44, 0x0a, 0x40, 0x41, 0x52, 0x47, 0x0a, 0x44, 0x3d, 0x4d,
+    0x0a, 0x40, 0x53, 0x50, 0x0a, 0x41, 0x4d, 0x3d, 0x4d, 0x2b, 0x31, 0x0a,
+    0x41, 0x3d, 0x41, 0x2d, 0x31, 0x0a, 0x4d, 0x3d, 0x44, 0x0a, 0x40, 0x54,
+    0x48, 0x49, 0x53, 0x0a, 0x44, 0x3d, 0x4d, 0x0a, 0x40, 0x53, 0x50, 0x0a,
+    0x41, 0x4d, 0x3d, 0x4d, 0x2b, 0x31, 0x0a, 0x41, 0x3d, 0x41, 0x2d, 0x31,
+    0x0a, 0x4d, 0x3d, 0x44, 0x0a, 0x40, 0x54, 0x48, 0x41, 0x54, 0x0a, 0x44,
+    0x3d, 0x4d, 0x0a, 0x40, 0x53, 0x50, 0x0a, 0x41, 0x4d, 0x3d, 0x4d, 0x2b,
+    0x31, 0x0a, 0x41, 0x3d, 0x41, 0x2d, 0x31, 0x0a, 0x4d, 0x3d, 0x44, 0x0a,
+    0x2f, 0x2f, 0x20, 0x73, 0x65, 0x74, 0x20, 0x41, 0x52, 0x47, 0x20, 0x3d,
+    0x20, 0x53, 0x50, 0x20, 0x2d, 0x20, 0x35, 0x20, 0x2d, 0x20, 0x52, 0x31,
+    0x34, 0x0a, 0x40, 0x52, 0x31, 0x34, 0x0a, 0x44, 0x3d, 0x4d, 0x0a, 0x40,
+    0x35, 0x0a, 0x44, 0x3d, 0x44, 0x2b, 0x41, 0x0a, 0x40, 0x53, 0x50, 0x0a,
+    0x44, 0x3d, 0x4d, 0x2d, 0x44, 0x0a, 0x40, 0x41, 0x52, 0x47, 0x0a, 0x4d,
+    0x3d, 0x44, 0x0a, 0x2f, 0x2f, 0x20, 0x4c, 0x43, 0x4c, 0x20, 0x3d, 0x20,
+    0x53, 0x50, 0x0a, 0x40, 0x53, 0x50, 0x0a, 0x44, 0x3d, 0x4d, 0x0a, 0x40,
+    0x4c, 0x43, 0x4c, 0x0a, 0x4d, 0x3d, 0x44, 0x0a, 0x40, 0x52, 0x31, 0x33,
+    0x0a, 0x41, 0x3d, 0x4d, 0x0a, 0x30, 0x3b, 0x4a, 0x4d, 0x50, 0x0a, 0x28,
+    0x56, 0x4d, 0x24, 0x72, 0x65, 0x74, 0x75, 0x72, 0x6e, 0x29, 0x0a, 0x2f,
+    0x2f, 0x20, 0x52, 0x65, 0x67, 0x69, 0x73, 0x74, 0x65, 0x72, 0x20, 0x72,
+    0x65, 0x74, 0x75, 0x72, 0x6e, 0x41, 0x64, 0x64, 0x72, 0x65, 0x73, 0x73,
+    0x20, 0x61, 0x6e, 0x64, 0x20, 0x65, 0x6e, 0x64, 0x46, 0x72, 0x61, 0x6d,
+    0x65, 0x0a, 0x40, 0x4c, 0x43, 0x4c, 0x0a, 0x44, 0x3d, 0x4d, 0x0a, 0x40,
+    0x52, 0x31, 0x33, 0x20, 0x2f, 0x2f, 0x20, 0x65, 0x6e, 0x64, 0x46, 0x72,
+    0x61, 0x6d, 0x65, 0x0a, 0x4d, 0x3d, 0x44, 0x0a, 0x40, 0x35, 0x0a, 0x44,
+    0x3d, 0x44, 0x2d, 0x41, 0x0a, 0x41, 0x3d, 0x44, 0x0a, 0x44, 0x3d, 0x4d,
+    0x0a, 0x40, 0x52, 0x31, 0x34, 0x20, 0x2f, 0x2f, 0x20, 0x72, 0x65, 0x74,
+    0x41, 0x64, 0x64, 0x72, 0x0a, 0x4d, 0x3d, 0x44, 0x0a, 0x2f, 0x2f, 0x20,
+    0x70, 0x6f, 0x70, 0x20, 0x61, 0x72, 0x67, 0x20, 0x30, 0x0a, 0x40, 0x53,
+    0x50, 0x0a, 0x4d, 0x3d, 0x4d, 0x2d, 0x31, 0x0a, 0x41, 0x3d, 0x4d, 0x0a,
+    0x44, 0x3d, 0x4d, 0x0a, 0x40, 0x41, 0x52, 0x47, 0x0a, 0x41, 0x3d, 0x4d,
+    0x0a, 0x4d, 0x3d, 0x44, 0x0a, 0x2f, 0x2f, 0x20, 0x53, 0x50, 0x20, 0x3d,
+    0x20, 0x2a, 0x41, 0x52, 0x47, 0x2b, 0x31, 0x0a, 0x40, 0x41, 0x52, 0x47,
+    0x0a, 0x44, 0x3d, 0x4d, 0x2b, 0x31, 0x0a, 0x40, 0x53, 0x50, 0x0a, 0x4d,
+    0x3d, 0x44, 0x0a, 0x2f, 0x2f, 0x20, 0x52, 0x65, 0x73, 0x74, 0x6f, 0x72,
+    0x65, 0x20, 0x63, 0x61, 0x6c, 0x6c, 0x65, 0x72, 0x20, 0x66, 0x72, 0x61,
+    0x6d, 0x65, 0x0a, 0x40, 0x52, 0x31, 0x33, 0x0a, 0x4d, 0x3d, 0x4d, 0x2d,
+    0x31, 0x0a, 0x41, 0x3d, 0x4d, 0x0a, 0x44, 0x3d, 0x4d, 0x0a, 0x40, 0x54,
+    0x48, 0x41, 0x54, 0x0a, 0x4d, 0x3d, 0x44, 0x0a, 0x40, 0x52, 0x31, 0x33,
+    0x0a, 0x4d, 0x3d, 0x4d, 0x2d, 0x31, 0x0a, 0x41, 0x3d, 0x4d, 0x0a, 0x44,
+    0x3d, 0x4d, 0x0a, 0x40, 0x54, 0x48, 0x49, 0x53, 0x0a, 0x4d, 0x3d, 0x44,
+    0x0a, 0x40, 0x52, 0x31, 0x33, 0x0a, 0x4d, 0x3d, 0x4d, 0x2d, 0x31, 0x0a,
+    0x41, 0x3d, 0x4d, 0x0a, 0x44, 0x3d, 0x4d, 0x0a, 0x40, 0x41, 0x52, 0x47,
+    0x0a, 0x4d, 0x3d, 0x44, 0x0a, 0x40, 0x52, 0x31, 0x33, 0x0a, 0x4d, 0x3d,
+    0x4d, 0x2d, 0x31, 0x0a, 0x41, 0x3d, 0x4d, 0x0a, 0x44, 0x3d, 0x4d, 0x0a,
+    0x40, 0x4c, 0x43, 0x4c, 0x0a, 0x4d, 0x3d, 0x44, 0x0a, 0x2f, 0x2f, 0x20,
+    0x4a, 0x75, 0x6d, 0x70, 0x20, 0x74, 0x6f, 0x20, 0x74, 0x68, 0x65, 0x20,
+    0x73, 0x61, 0x76, 0x65, 0x64, 0x20, 0x72, 0x65, 0x74, 0x75, 0x72, 0x6e,
+    0x20, 0x61, 0x64, 0x64, 0x72, 0x65, 0x73, 0x73, 0x0a, 0x40, 0x52, 0x31,
+    0x34, 0x0a, 0x41, 0x3d, 0x4d, 0x0a, 0x30, 0x3b, 0x4a, 0x4d, 0x50, 0x0a,
+    0x2f, 0x2f, 0x20, 0x67, 0x74, 0x2c, 0x20, 0x6c, 0x74, 0x2c, 0x20, 0x65,
+    0x71, 0x20, 0x3a, 0x20, 0x44, 0x20, 0x3d, 0x20, 0x72, 0x65, 0x74, 0x75,
+    0x72, 0x6e, 0x20, 0x61, 0x64, 0x64, 0x72, 0x65, 0x73, 0x73, 0x2c, 0x20,
+    0x73, 0x61, 0x76, 0x65, 0x64, 0x20, 0x69, 0x6e, 0x20, 0x52, 0x31, 0x35,
+    0x0a, 0x2f, 0x2f, 0x20, 0x78, 0x20, 0x2d, 0x20, 0x79, 0x20, 0x69, 0x73,
+    0x20, 0x63, 0x6f, 0x6d, 0x70, 0x75, 0x74, 0x65, 0x64, 0x20, 0x61, 0x6e,
+    0x64, 0x20, 0x78, 0x20, 0x69, 0x73, 0x20, 0x73, 0x65, 0x74, 0x20, 0x74,
+    0x6f, 0x20, 0x74, 0x72, 0x75, 0x65, 0x2c, 0x20, 0x74, 0x68, 0x65, 0x6e,
+    0x20, 0x74, 0x6f, 0x20, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x20, 0x69, 0x66,
+    0x20, 0x74, 0x68, 0x65, 0x20, 0x74, 0x65, 0x73, 0x74, 0x20, 0x66, 0x61,
+    0x69, 0x6c, 0x73, 0x0a, 0x28, 0x56, 0x4d, 0x24, 0x67, 0x74, 0x29, 0x0a,
+    0x40, 0x52, 0x31, 0x35, 0x0a, 0x4d, 0x3d, 0x44, 0x0a, 0x40, 0x53, 0x50,
+    0x0a, 0x41, 0x4d, 0x3d, 0x4d, 0x2d, 0x31, 0x0a, 0x44, 0x3d, 0x4d, 0x0a,
+    0x41, 0x3d, 0x41, 0x2d, 0x31, 0x0a, 0x44, 0x3d, 0x4d, 0x2d, 0x44, 0x0a,
+    0x4d, 0x3d, 0x2d, 0x31, 0x0a, 0x40, 0x56, 0x4d, 0x24, 0x74, 0x72, 0x75,
+    0x65, 0x0a, 0x44, 0x3b, 0x4a, 0x47, 0x54, 0x0a, 0x40, 0x56, 0x4d, 0x24,
+    0x66, 0x61, 0x6c, 0x73, 0x65, 0x0a, 0x30, 0x3b, 0x4a, 0x4d, 0x50, 0x0a,
+    0x28, 0x56, 0x4d, 0x24, 0x6c, 0x74, 0x29, 0x0a, 0x40, 0x52, 0x31, 0x35,
+    0x0a, 0x4d, 0x3d, 0x44, 0x0a, 0x40, 0x53, 0x50, 0x0a, 0x41, 0x4d, 0x3d,
+    0x4d, 0x2d, 0x31, 0x0a, 0x44, 0x3d, 0x4d, 0x0a, 0x41, 0x3d, 0x41, 0x2d,
+    0x31, 0x0a, 0x44, 0x3d, 0x4d, 0x2d, 0x44, 0x0a, 0x4d, 0x3d, 0x2d, 0x31,
+    0x0a, 0x40, 0x56, 0x4d, 0x24, 0x74, 0x72, 0x75, 0x65, 0x0a, 0x44, 0x3b,
+    0x4a, 0x4c, 0x54, 0x0a, 0x40, 0x56, 0x4d, 0x24, 0x66, 0x61, 0x6c, 0x73,
+    0x65, 0x0a, 0x30, 0x3b, 0x4a, 0x4d, 0x50, 0x0a, 0x28, 0x56, 0x4d, 0x24,
+    0x65, 0x71, 0x29, 0x0a, 0x40, 0x52, 0x31, 0x35, 0x0a, 0x4d, 0x3d, 0x44,
+    0x0a, 0x40, 0x53, 0x50, 0x0a, 0x41, 0x4d, 0x3d, 0x4d, 0x2d, 0x31, 0x0a,
+    0x44, 0x3d, 0x4d, 0x0a, 0x41, 0x3d, 0x41, 0x2d, 0x31, 0x0a, 0x44, 0x3d,
+    0x4d, 0x2d, 0x44, 0x0a, 0x4d, 0x3d, 0x2d, 0x31, 0x0a, 0x40, 0x56, 0x4d,
+    0x24, 0x74, 0x72, 0x75, 0x65, 0x0a, 0x44, 0x3b, 0x4a, 0x45, 0x51, 0x0a,
+    0x28, 0x56, 0x4d, 0x24, 0x66, 0x61, 0x6c, 0x73, 0x65, 0x29, 0x0a, 0x40,
+    0x53, 0x50, 0x0a, 0x41, 0x3d, 0x4d, 0x2d, 0x31, 0x0a, 0x4d, 0x3d, 0x30,
+    0x0a, 0x28, 0x56, 0x4d, 0x24, 0x74, 0x72, 0x75, 0x65, 0x29, 0x0a, 0x40,
+    0x52, 0x31, 0x35, 0x0a, 0x41, 0x3d, 0x4d, 0x0a, 0x30, 0x3b, 0x4a, 0x4d,
+    0x50, 0x0a, 0x28, 0x56, 0x4d, 0x24, 0x65, 0x6e, 0x64, 0x29, 0x0a, 0x00};
+unsigned int shared_asm_len = 1247;
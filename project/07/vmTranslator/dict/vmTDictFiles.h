@@ -89,4 +89,22 @@ extern unsigned int return_asm_len;
 
 extern const char init_asm[];
 extern unsigned int init_asm_len;
+
+extern const char call_shared_asm[];
+extern unsigned int call_shared_asm_len;
+
+extern const char return_shared_asm[];
+extern unsigned int return_shared_asm_len;
+
+extern const char eq_shared_asm[];
+extern unsigned int eq_shared_asm_len;
+
+extern const char gt_shared_asm[];
+extern unsigned int gt_shared_asm_len;
+
+extern const char lt_shared_asm[];
+extern unsigned int lt_shared_asm_len;
+
+extern const char shared_asm[];
+extern unsigned int shared_asm_len;
 #endif  // _DICT_VMTDICTFILES_H_
@@ -14,16 +14,61 @@
  */
 #include "vmTMain.h"
 
+/* Writes the commands of the window that can be decided, all of them if
+ * final is true. p_cmd gives the current function name.
+ */
+static void flush_window(FusionWindow *p_window, bool final,
+                         VMOutput *p_output, const VMCommand *p_cmd,
+                         const VMSymbols *p_symbols,
+                         LabelCounter *p_labelCounter,
+                         const VMTemplates *p_templates,
+                         const char *basename) {
+    while (p_window->size > 0) {
+        int count = fusion_length(p_window->commands, p_window->size, final);
+        if (count == 0) {
+            return;
+        }
+        if (count == 1) {
+            VMCommand single = p_window->commands[0];
+            single.functionName = p_cmd->functionName;
+            write_to_file(p_output, &single, p_symbols, p_labelCounter,
+                          p_templates, choose_asm_dict_file(&single),
+                          basename, basename);
+        } else {
+            write_fused(p_output, p_window->commands, count, basename);
+        }
+        p_window->size -= count;
+        memmove(p_window->commands, p_window->commands + count,
+                p_window->size * sizeof(VMCommand));
+    }
+}
+
 int main(int argc, char **argv) {
     IOFiles ioFiles;
-    if (argc > 2) {
-        printf("Too many arguments supplied.\n");
-        return 1;
-    } else if (argc <= 1) {
+    bool optimize = false;
+    bool shared = false;
+    const char *filename = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-O") == 0) {
+            optimize = true;
+        } else if (strcmp(argv[i], "--shared") == 0) {
+            shared = true;
+        } else if (filename != NULL) {
+            printf("Too many arguments supplied.\n");
+            return 1;
+        } else {
+            filename = argv[i];
+        }
+    }
+    if (filename == NULL) {
         printf("One argument expected.\n");
+        printf("Usage : VMTranslator [-O] [--shared] file.vm|directory\n");
+        printf("  -O        fuses the pushes and pops into direct moves\n");
+        printf("  --shared  writes call, return and comparisons once, as "
+               "routines\n");
         return 1;
     } else {
-        ioFiles = open_filestreams(argv[1]);
+        ioFiles = open_filestreams(filename);
         if (!IOF_check(&ioFiles)) {
             fprintf(stderr, "Problem in IOFiles");
             return 1;
@@ -35,13 +80,24 @@ int main(int argc, char **argv) {
     LC_init(&LabelCounter);
     VMCommand cmd;
     VMC_init(&cmd);
+    VMSymbols symbols;
+    VMS_init(&symbols);
+    VMTemplates templates;
+    VMT_init(&templates, shared);
+    VMOutput output;
+    VMO_init(&output, ioFiles.output);
+    FusionWindow window;
+    window.size = 0;
 
     // Allocation of resources for the translation
     char line[LINE_BUFFERSIZE];
 
     // Add init only if there are multiple files
     if (ioFiles.fileCount > 1) {
-        fprintf(ioFiles.output, "%s", init_asm);
+        VMO_append(&output, init_asm, strlen(init_asm));
+    }
+    if (shared) {
+        VMO_append(&output, shared_asm, strlen(shared_asm));
     }
 
     // .vm file parsing loop
@@ -49,34 +105,46 @@ int main(int argc, char **argv) {
         IOF_set_basename(&ioFiles, ioFiles.input_filenames[i]);
         VMC_set_function_name(&cmd, ioFiles.basename);
         while (fgets(line, LINE_BUFFERSIZE - 1, ioFiles.input[i]) != NULL) {
-            int command_length = parse_line(line, &cmd);
+            int command_length = parse_line(line, &cmd, &symbols);
             // Skip the line if it is a comment
             if (command_length == 0) {
                 continue;
             } else {
+                if (cmd.opcode == VM_FUNCTION) {
+                    VMC_set_function_name(&cmd, VMS_name(&symbols, cmd.symbol));
+                }
                 // This is where we should call the writing functions
-                const char *asm_dict_file =
-                    choose_asm_dict_file(&cmd, command_length);
-                if (asm_dict_file == NULL) {
+                VMStub stub = choose_asm_dict_file(&cmd);
+                if (stub == STUB_NONE) {
                     fprintf(stderr, "No stub found ! File : %s Command : %s\n",
                             ioFiles.input_filenames[i], line);
-
-                    for (int j = 0; j < command_length; ++j) {
-                        fprintf(stderr, "%s ", cmd.command[j]);
-                    }
-                    fprintf(stderr, "\n");
                     exit(1);
                 }
-                write_to_file(ioFiles.output, &cmd, &LabelCounter,
-                              asm_dict_file, ioFiles.basename,
-                              ioFiles.basename);
+                if (!optimize) {
+                    write_to_file(&output, &cmd, &symbols, &LabelCounter,
+                                  &templates, stub, ioFiles.basename,
+                                  ioFiles.basename);
+                    continue;
+                }
+                window.commands[window.size++] = cmd;
+                flush_window(&window, false, &output, &cmd, &symbols,
+                             &LabelCounter, &templates, ioFiles.basename);
             }
         }
+        // The static names change with the file
+        flush_window(&window, true, &output, &cmd, &symbols, &LabelCounter,
+                     &templates, ioFiles.basename);
     }
 
     // Cleanup
+    bool written = VMO_clear(&output);
+    if (!written) {
+        fprintf(stderr, "Could not write the translation\n");
+    }
     IOF_clear(&ioFiles);
     VMC_clear(&cmd);
+    VMS_clear(&symbols);
+    VMT_clear(&templates);
 
-    return 0;
+    return written ? 0 : 1;
 }
@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "vmTOptimizer.h"
 #include "vmTParser.h"
 #include "vmTTools.h"
 #include "vmTWriter.h"
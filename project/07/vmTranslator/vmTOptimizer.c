@@ -0,0 +1,269 @@
+/* Copyright 2017 Gerry Agbobada
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "vmTOptimizer.h"
+
+static const char* const segment_names[] = {
+    [SEG_NONE] = "",         [SEG_ARGUMENT] = "argument",
+    [SEG_LOCAL] = "local",   [SEG_STATIC] = "static",
+    [SEG_CONSTANT] = "constant", [SEG_THIS] = "this",
+    [SEG_THAT] = "that",     [SEG_POINTER] = "pointer",
+    [SEG_TEMP] = "temp"};
+
+static bool is_binary(VMOpcode opcode) {
+    return opcode == VM_ADD || opcode == VM_SUB || opcode == VM_AND ||
+           opcode == VM_OR;
+}
+
+static bool is_classic(VMSegment segment) {
+    return segment == SEG_LOCAL || segment == SEG_ARGUMENT ||
+           segment == SEG_THIS || segment == SEG_THAT;
+}
+
+// pointer only has 2 cells, the other commands are written alone so that
+// the writer reports them
+static bool is_push(const VMCommand* p_cmd) {
+    return p_cmd->opcode == VM_PUSH &&
+           (p_cmd->segment != SEG_POINTER || p_cmd->index <= 1);
+}
+
+static bool is_pop(const VMCommand* p_cmd) {
+    return p_cmd->opcode == VM_POP && p_cmd->segment != SEG_CONSTANT &&
+           (p_cmd->segment != SEG_POINTER || p_cmd->index <= 1);
+}
+
+// true if the value or cell of the push or pop is reached without D
+static bool is_direct(const VMCommand* p_cmd) {
+    return !is_classic(p_cmd->segment) || p_cmd->index <= FUSION_MAX_OFFSET;
+}
+
+int fusion_length(const VMCommand* cmds, int size, bool final) {
+    if (!is_push(&cmds[0])) {
+        return 1;
+    }
+    if (size < 2) {
+        return final ? 1 : 0;
+    }
+    if (is_pop(&cmds[1])) {
+        return 2;
+    }
+    if (!is_push(&cmds[1])) {
+        return 1;
+    }
+    if (size < 3) {
+        return final ? 1 : 0;
+    }
+    if (!is_binary(cmds[2].opcode) ||
+        !(is_direct(&cmds[0]) || is_direct(&cmds[1]))) {
+        return 1;
+    }
+    if (size < 4) {
+        return final ? 3 : 0;
+    }
+    return is_pop(&cmds[3]) ? 4 : 3;
+}
+
+static const char* classic_base(VMSegment segment) {
+    switch (segment) {
+        case SEG_LOCAL:
+            return "LCL";
+        case SEG_ARGUMENT:
+            return "ARG";
+        case SEG_THIS:
+            return "THIS";
+        default:
+            return "THAT";
+    }
+}
+
+/* Writes the code that puts the cell of a direct push or pop in A, or the
+ * value itself for a constant
+ * Returns the operand holding the value : 'A' or 'M'
+ */
+static char write_address(VMOutput* p_output, const VMCommand* p_cmd,
+                          const char* staticName) {
+    switch (p_cmd->segment) {
+        case SEG_CONSTANT:
+            VMO_append(p_output, "@", 1);
+            VMO_append_int(p_output, p_cmd->index);
+            VMO_append(p_output, "\n", 1);
+            return 'A';
+        case SEG_TEMP:
+            VMO_append(p_output, "@", 1);
+            VMO_append_int(p_output, 5 + p_cmd->index);
+            VMO_append(p_output, "\n", 1);
+            return 'M';
+        case SEG_STATIC:
+            VMO_append(p_output, "@", 1);
+            VMO_append_string(p_output, staticName);
+            VMO_append(p_output, ".", 1);
+            VMO_append_int(p_output, p_cmd->index);
+            VMO_append(p_output, "\n", 1);
+            return 'M';
+        case SEG_POINTER:
+            VMO_append_string(p_output,
+                              p_cmd->index == 0 ? "@THIS\n" : "@THAT\n");
+            return 'M';
+        default:
+            VMO_append(p_output, "@", 1);
+            VMO_append_string(p_output, classic_base(p_cmd->segment));
+            if (p_cmd->index == 0) {
+                VMO_append_string(p_output, "\nA=M\n");
+            } else {
+                VMO_append_string(p_output, "\nA=M+1\n");
+                for (int i = 1; i < p_cmd->index; ++i) {
+                    VMO_append_string(p_output, "A=A+1\n");
+                }
+            }
+            return 'M';
+    }
+}
+
+// Writes D = value of the push
+static void write_load(VMOutput* p_output, const VMCommand* p_cmd,
+                       const char* staticName) {
+    if (p_cmd->segment == SEG_CONSTANT && p_cmd->index <= 1) {
+        VMO_append_string(p_output, p_cmd->index == 0 ? "D=0\n" : "D=1\n");
+    } else if (is_direct(p_cmd)) {
+        char operand = write_address(p_output, p_cmd, staticName);
+        VMO_append_string(p_output, operand == 'A' ? "D=A\n" : "D=M\n");
+    } else {
+        VMO_append(p_output, "@", 1);
+        VMO_append_int(p_output, p_cmd->index);
+        VMO_append_string(p_output, "\nD=A\n@");
+        VMO_append_string(p_output, classic_base(p_cmd->segment));
+        VMO_append_string(p_output, "\nA=D+M\nD=M\n");
+    }
+}
+
+// The cell of a pop with a large index is computed in R13 first, since
+// D then holds the value
+static void write_store_address(VMOutput* p_output, const VMCommand* p_cmd) {
+    if (is_direct(p_cmd)) {
+        return;
+    }
+    VMO_append(p_output, "@", 1);
+    VMO_append_int(p_output, p_cmd->index);
+    VMO_append_string(p_output, "\nD=A\n@");
+    VMO_append_string(p_output, classic_base(p_cmd->segment));
+    VMO_append_string(p_output, "\nD=D+M\n@R13\nM=D\n");
+}
+
+// Writes the cell of the pop = D
+static void write_store(VMOutput* p_output, const VMCommand* p_cmd,
+                        const char* staticName) {
+    if (is_direct(p_cmd)) {
+        write_address(p_output, p_cmd, staticName);
+        VMO_append_string(p_output, "M=D\n");
+    } else {
+        VMO_append_string(p_output, "@R13\nA=M\nM=D\n");
+    }
+}
+
+// Writes D = x op y, x being pushed first
+static void write_binary(VMOutput* p_output, const VMCommand* p_x,
+                         const VMCommand* p_y, VMOpcode opcode,
+                         const char* staticName) {
+    // The direct operand is read with A, the other one is loaded in D
+    bool yDirect = is_direct(p_y);
+    write_load(p_output, yDirect ? p_x : p_y, staticName);
+    char operand = write_address(p_output, yDirect ? p_y : p_x, staticName);
+    char comp[8];
+    switch (opcode) {
+        case VM_ADD:
+            sprintf(comp, "D=D+%c\n", operand);
+            break;
+        case VM_SUB:
+            if (yDirect) {
+                sprintf(comp, "D=D-%c\n", operand);
+            } else {
+                sprintf(comp, "D=%c-D\n", operand);
+            }
+            break;
+        case VM_AND:
+            sprintf(comp, "D=D&%c\n", operand);
+            break;
+        default:
+            sprintf(comp, "D=D|%c\n", operand);
+            break;
+    }
+    VMO_append_string(p_output, comp);
+}
+
+// Writes the commands as a comment : "// push local 2 / pop this 1"
+static void write_comment(VMOutput* p_output, const VMCommand* cmds,
+                          int count) {
+    VMO_append(p_output, "//", 2);
+    for (int i = 0; i < count; ++i) {
+        VMO_append_string(p_output, i == 0 ? " " : " / ");
+        switch (cmds[i].opcode) {
+            case VM_PUSH:
+            case VM_POP:
+                VMO_append_string(p_output,
+                                  cmds[i].opcode == VM_PUSH ? "push " : "pop ");
+                VMO_append_string(p_output, segment_names[cmds[i].segment]);
+                VMO_append(p_output, " ", 1);
+                VMO_append_int(p_output, cmds[i].index);
+                break;
+            case VM_ADD:
+                VMO_append_string(p_output, "add");
+                break;
+            case VM_SUB:
+                VMO_append_string(p_output, "sub");
+                break;
+            case VM_AND:
+                VMO_append_string(p_output, "and");
+                break;
+            default:
+                VMO_append_string(p_output, "or");
+                break;
+        }
+    }
+    VMO_append(p_output, "\n", 1);
+}
+
+void write_fused(VMOutput* p_output, const VMCommand* cmds, int count,
+                 const char* staticName) {
+    write_comment(p_output, cmds, count);
+    const VMCommand* p_pop = NULL;
+    if (count == 2) {
+        p_pop = &cmds[1];
+    } else if (count == 4) {
+        p_pop = &cmds[3];
+    }
+    if (p_pop != NULL) {
+        write_store_address(p_output, p_pop);
+    }
+
+    if (count == 2) {
+        // 0 and 1 are written without D
+        if (cmds[0].segment == SEG_CONSTANT && cmds[0].index <= 1 &&
+            is_direct(p_pop)) {
+            write_address(p_output, p_pop, staticName);
+            VMO_append_string(p_output,
+                              cmds[0].index == 0 ? "M=0\n" : "M=1\n");
+            return;
+        }
+        write_load(p_output, &cmds[0], staticName);
+    } else {
+        write_binary(p_output, &cmds[0], &cmds[1], cmds[2].opcode,
+                     staticName);
+    }
+
+    if (p_pop != NULL) {
+        write_store(p_output, p_pop, staticName);
+    } else {
+        VMO_append_string(p_output, "@SP\nA=M\nM=D\n@SP\nM=M+1\n");
+    }
+}
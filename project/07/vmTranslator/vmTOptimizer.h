@@ -0,0 +1,62 @@
+/* Copyright 2017 Gerry Agbobada
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 3 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _VMTOPTIMIZER_H_
+#define _VMTOPTIMIZER_H_
+#ifndef __STDC_WANT_LIB_EXT2__
+#define __STDC_WANT_LIB_EXT2__ 1
+#endif  // __STDC_WANT_LIB_EXT2__
+// Longest run of commands fused together
+#define FUSION_WINDOW 4
+// Largest index of local, argument, this or that reached by incrementing A,
+// larger ones compute their address in D
+#define FUSION_MAX_OFFSET 5
+
+#include <stdbool.h>
+#include "vmTTools.h"
+#include "vmTWriter.h"
+
+/* Push/pop fusion, enabled with -O
+ * The commands that only move values through the stack are written as
+ * direct moves between the segments :
+ * - push X / pop Z : D = X, then Z = D,
+ * - push X / push Y / add|sub|and|or / pop Z : D = X op Y, then Z = D,
+ * - push X / push Y / add|sub|and|or : D = X op Y, then D is pushed.
+ * The stack cells above SP are not written anymore, as no command reads
+ * them before pushing again.
+ * A binary operation is only fused if one of its operands can be reached
+ * without D (a constant, temp, static, pointer, or a small index).
+ */
+
+// Commands waiting to be fused
+typedef struct FusionWindow {
+    VMCommand commands[FUSION_WINDOW];
+    int size;
+} FusionWindow;
+
+/* Returns the number of commands at the start of cmds (size of them) that
+ * are written together, 1 if the first one is written alone, or 0 if more
+ * commands are needed to decide. 0 is never returned when final is true,
+ * or when size is FUSION_WINDOW.
+ */
+int fusion_length(const VMCommand* cmds, int size, bool final);
+
+/* Writes the count commands of cmds as one piece of code, count being
+ * given by fusion_length and at least 2
+ * staticName : prefix of the static variables
+ */
+void write_fused(VMOutput* p_output, const VMCommand* cmds, int count,
+                 const char* staticName);
+
+#endif  // _VMTOPTIMIZER_H_
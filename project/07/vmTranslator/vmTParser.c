@@ -14,22 +14,127 @@
  */
 #include "vmTParser.h"
 
-int parse_line(const char* line, VMCommand* p_cmd) {
+#include <limits.h>
+
+typedef struct VMKeyword {
+    const char* word;
+    VMOpcode opcode;
+    VMSegment segment;
+} VMKeyword;
+
+// Slots given by VM_KEYWORD_HASH, the other ones are empty
+static const VMKeyword keywords[VM_KEYWORD_SLOTS] = {
+    [49] = {"add", VM_ADD, SEG_NONE},
+    [1] = {"sub", VM_SUB, SEG_NONE},
+    [54] = {"neg", VM_NEG, SEG_NONE},
+    [57] = {"eq", VM_EQ, SEG_NONE},
+    [55] = {"gt", VM_GT, SEG_NONE},
+    [60] = {"lt", VM_LT, SEG_NONE},
+    [5] = {"and", VM_AND, SEG_NONE},
+    [23] = {"or", VM_OR, SEG_NONE},
+    [52] = {"not", VM_NOT, SEG_NONE},
+    [42] = {"push", VM_PUSH, SEG_NONE},
+    [46] = {"pop", VM_POP, SEG_NONE},
+    [6] = {"label", VM_LABEL, SEG_NONE},
+    [19] = {"goto", VM_GOTO, SEG_NONE},
+    [3] = {"if-goto", VM_IF_GOTO, SEG_NONE},
+    [12] = {"function", VM_FUNCTION, SEG_NONE},
+    [61] = {"call", VM_CALL, SEG_NONE},
+    [56] = {"return", VM_RETURN, SEG_NONE},
+    [45] = {"argument", VM_UNKNOWN, SEG_ARGUMENT},
+    [34] = {"local", VM_UNKNOWN, SEG_LOCAL},
+    [17] = {"static", VM_UNKNOWN, SEG_STATIC},
+    [41] = {"constant", VM_UNKNOWN, SEG_CONSTANT},
+    [26] = {"this", VM_UNKNOWN, SEG_THIS},
+    [44] = {"that", VM_UNKNOWN, SEG_THAT},
+    [18] = {"pointer", VM_UNKNOWN, SEG_POINTER},
+    [30] = {"temp", VM_UNKNOWN, SEG_TEMP}};
+
+// Returns the keyword of the word, or NULL
+static const VMKeyword* find_keyword(const char* word, size_t length) {
+    if (length < 2) {
+        return NULL;
+    }
+    const VMKeyword* p_keyword = keywords + VM_KEYWORD_HASH(word, length);
+    if (p_keyword->word == NULL ||
+        strncmp(p_keyword->word, word, length) != 0 ||
+        p_keyword->word[length] != '\0') {
+        return NULL;
+    }
+    return p_keyword;
+}
+
+// Converts the word to a non negative int, returns false if it is not one
+static bool parse_index(const char* word, size_t length, int* p_index) {
+    int index = 0;
+    for (size_t i = 0; i < length; ++i) {
+        if (word[i] < '0' || word[i] > '9' || index > (INT_MAX - 9) / 10) {
+            return false;
+        }
+        index = 10 * index + (word[i] - '0');
+    }
+    *p_index = index;
+    return length > 0;
+}
+
+int parse_line(const char* line, VMCommand* p_cmd, VMSymbols* p_symbols) {
+    const char* words[MAX_COMMAND_WORDS];
+    size_t lengths[MAX_COMMAND_WORDS];
     int wordCount = 0;
-    char* nextWord = NULL;
-    char* line_copy = strdup(line);
+    const char* separators = " \n\r\t";
 
-    // Read each token into command, until
-    nextWord = strtok(line_copy, " \n\r\t");
-    while (nextWord != NULL && wordCount < MAX_COMMAND_WORDS) {
+    // Read each word until the end of the line or a comment
+    const char* nextWord = line + strspn(line, separators);
+    while (*nextWord != '\0' && wordCount < MAX_COMMAND_WORDS) {
         if (strncmp(nextWord, "//", 2) == 0) {
             break;
         }
-        strcpy(p_cmd->command[wordCount], nextWord);
+        words[wordCount] = nextWord;
+        lengths[wordCount] = strcspn(nextWord, separators);
+        nextWord += lengths[wordCount];
+        nextWord += strspn(nextWord, separators);
         ++wordCount;
-        nextWord = strtok(NULL, " \n\r\t");
     }
 
-    free(line_copy);
+    p_cmd->opcode = VM_UNKNOWN;
+    p_cmd->segment = SEG_NONE;
+    p_cmd->index = 0;
+    p_cmd->symbol = -1;
+    if (wordCount == 0) {
+        return 0;
+    }
+    const VMKeyword* p_keyword = find_keyword(words[0], lengths[0]);
+    if (p_keyword == NULL) {
+        return wordCount;
+    }
+
+    // Words expected after the command
+    VMOpcode opcode = p_keyword->opcode;
+    int arguments = 0;
+    if (opcode == VM_LABEL || opcode == VM_GOTO || opcode == VM_IF_GOTO) {
+        arguments = 1;
+    } else if (opcode == VM_PUSH || opcode == VM_POP ||
+               opcode == VM_FUNCTION || opcode == VM_CALL) {
+        arguments = 2;
+    }
+    if (wordCount != arguments + 1) {
+        return wordCount;
+    }
+
+    if (opcode == VM_PUSH || opcode == VM_POP) {
+        const VMKeyword* p_segment = find_keyword(words[1], lengths[1]);
+        if (p_segment == NULL || p_segment->segment == SEG_NONE ||
+            !parse_index(words[2], lengths[2], &p_cmd->index)) {
+            return wordCount;
+        }
+        p_cmd->segment = p_segment->segment;
+    } else if (arguments > 0) {
+        p_cmd->symbol = VMS_intern(p_symbols, words[1], lengths[1]);
+        if (arguments == 2 &&
+            !parse_index(words[2], lengths[2], &p_cmd->index)) {
+            return wordCount;
+        }
+    }
+    p_cmd->opcode = opcode;
     return wordCount;
 }
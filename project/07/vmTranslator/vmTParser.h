@@ -21,11 +21,27 @@
 #include <string.h>
 #include "vmTTools.h"
 
-/* Parse the words on the line, and put results in command array
- * returns the number of words read, so if it returns 0 we can
- * go the the next line in main
- * command has to be malloc'd to be size MAX_COMMAND_WORDS
+// Size of the keyword table, a power of 2
+#define VM_KEYWORD_SLOTS 64
+
+/* Perfect hash of the keywords of the VM language : every command and
+ * segment name falls in its own slot of the keyword table, so a word is
+ * recognised with one hash and one comparison.
+ * The word has at least 2 chars.
+ */
+#define VM_KEYWORD_HASH(word, length)                           \
+    (((unsigned char)(word)[0] + 2 * (unsigned char)(word)[1] + \
+      18 * (unsigned char)(word)[(length)-1]) &                 \
+     (VM_KEYWORD_SLOTS - 1))
+
+/* Parse the words on the line into p_cmd, without copying them : the
+ * opcode and segment are looked up in the keyword table, the index is
+ * converted to an int, and the label or function name is interned in
+ * p_symbols.
+ * Returns the number of words read, so if it returns 0 we can
+ * go the the next line in main. If the line is not a valid command,
+ * p_cmd->opcode is VM_UNKNOWN.
  */
-int parse_line(const char* line, VMCommand* p_cmd);
+int parse_line(const char* line, VMCommand* p_cmd, VMSymbols* p_symbols);
 
 #endif  // _VMTPARSER_H_
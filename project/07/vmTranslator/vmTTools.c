@@ -141,23 +141,119 @@ bool IOF_check(IOFiles *p_ioFiles) {
 }
 
 void VMC_init(VMCommand *p_vmc) {
-    p_vmc->command = calloc(MAX_COMMAND_WORDS, sizeof(char *));
-    for (int i = 0; i < MAX_COMMAND_WORDS; ++i) {
-        p_vmc->command[i] = calloc(MAX_COMMAND_WORD_LENGTH, sizeof(char *));
+    p_vmc->opcode = VM_UNKNOWN;
+    p_vmc->segment = SEG_NONE;
+    p_vmc->index = 0;
+    p_vmc->symbol = -1;
+    p_vmc->functionName = NULL;
+}
+
+void VMC_clear(VMCommand *p_vmc) { free(p_vmc->functionName); }
+
+void VMC_set_function_name(VMCommand *p_vmc, const char *newFunctionName) {
+    free(p_vmc->functionName);
+    p_vmc->functionName = strdup(newFunctionName);
+}
+
+// djb2 hash of the length first chars of name
+static unsigned long VMS_hash(const char *name, size_t length) {
+    unsigned long hash = 5381;
+    for (size_t i = 0; i < length; ++i) {
+        hash = hash * 33 + (unsigned char)name[i];
     }
+    return hash;
+}
 
-    p_vmc->functionName = NULL;
+// Returns the slot of name : the one holding its id, or the empty one
+// where it should be added
+static int VMS_find_slot(const VMSymbols *p_symbols, const char *name,
+                         size_t length) {
+    int slot = VMS_hash(name, length) & (p_symbols->slotCapacity - 1);
+    while (p_symbols->slots[slot] != -1) {
+        const char *candidate = p_symbols->names[p_symbols->slots[slot]];
+        if (strncmp(candidate, name, length) == 0 &&
+            candidate[length] == '\0') {
+            return slot;
+        }
+        slot = (slot + 1) & (p_symbols->slotCapacity - 1);
+    }
+    return slot;
 }
 
-void VMC_clear(VMCommand *p_vmc) {
-    for (int i = 0; i < MAX_COMMAND_WORDS; ++i) {
-        free(p_vmc->command[i]);
+void VMS_init(VMSymbols *p_symbols) {
+    p_symbols->size = 0;
+    p_symbols->capacity = VMS_INITIAL_CAPACITY;
+    p_symbols->names = malloc(p_symbols->capacity * sizeof(char *));
+    p_symbols->slotCapacity = 2 * VMS_INITIAL_CAPACITY;
+    p_symbols->slots = malloc(p_symbols->slotCapacity * sizeof(int));
+    if (p_symbols->names == NULL || p_symbols->slots == NULL) {
+        fprintf(stderr, "Could not allocate the symbols\n");
+        exit(1);
     }
-    free(p_vmc->command);
-    free(p_vmc->functionName);
+    memset(p_symbols->slots, -1, p_symbols->slotCapacity * sizeof(int));
 }
 
-void VMC_set_function_name(VMCommand *p_vmc, char *newFunctionName) {
-    free(p_vmc->functionName);
-    p_vmc->functionName = strdup(newFunctionName);
+void VMS_clear(VMSymbols *p_symbols) {
+    for (int i = 0; i < p_symbols->size; ++i) {
+        free(p_symbols->names[i]);
+    }
+    free(p_symbols->names);
+    free(p_symbols->slots);
+    p_symbols->names = NULL;
+    p_symbols->slots = NULL;
+    p_symbols->size = 0;
+    p_symbols->capacity = 0;
+    p_symbols->slotCapacity = 0;
+}
+
+int VMS_intern(VMSymbols *p_symbols, const char *name, size_t length) {
+    int slot = VMS_find_slot(p_symbols, name, length);
+    if (p_symbols->slots[slot] != -1) {
+        return p_symbols->slots[slot];
+    }
+
+    if (p_symbols->size == p_symbols->capacity) {
+        p_symbols->capacity *= 2;
+        char **newNames =
+            realloc(p_symbols->names, p_symbols->capacity * sizeof(char *));
+        if (newNames == NULL) {
+            fprintf(stderr, "Could not grow the symbols to %d\n",
+                    p_symbols->capacity);
+            exit(1);
+        }
+        p_symbols->names = newNames;
+    }
+    char *copy = malloc(length + 1);
+    if (copy == NULL) {
+        fprintf(stderr, "Could not allocate a symbol\n");
+        exit(1);
+    }
+    memcpy(copy, name, length);
+    copy[length] = '\0';
+    int id = p_symbols->size++;
+    p_symbols->names[id] = copy;
+    p_symbols->slots[slot] = id;
+
+    // Keep the table at most half full
+    if (2 * p_symbols->size > p_symbols->slotCapacity) {
+        free(p_symbols->slots);
+        p_symbols->slotCapacity *= 2;
+        p_symbols->slots = malloc(p_symbols->slotCapacity * sizeof(int));
+        if (p_symbols->slots == NULL) {
+            fprintf(stderr, "Could not grow the symbol slots to %d\n",
+                    p_symbols->slotCapacity);
+            exit(1);
+        }
+        memset(p_symbols->slots, -1, p_symbols->slotCapacity * sizeof(int));
+        for (int i = 0; i < p_symbols->size; ++i) {
+            const char *existing = p_symbols->names[i];
+            p_symbols->slots[VMS_find_slot(p_symbols, existing,
+                                           strlen(existing))] = i;
+        }
+    }
+    return id;
+}
+
+const char *VMS_name(const VMSymbols *p_symbols, int id) {
+    return p_symbols->names[id];
 }
@@ -18,7 +18,7 @@
 #define __STDC_WANT_LIB_EXT2__ 1
 #endif  // __STDC_WANT_LIB_EXT2__
 #define MAX_COMMAND_WORDS 3
-#define MAX_COMMAND_WORD_LENGTH 256
+#define VMS_INITIAL_CAPACITY 256
 #define MAX_NUMBER_OF_FILES 30
 
 #include <dirent.h>
@@ -47,13 +47,74 @@ void IOF_clear(IOFiles *p_ioFiles);
 void IOF_init(IOFiles *p_ioFiles);
 bool IOF_check(IOFiles *p_ioFiles);
 
+// Commands of the VM language
+typedef enum VMOpcode {
+    VM_UNKNOWN = 0,
+    VM_ADD,
+    VM_SUB,
+    VM_NEG,
+    VM_EQ,
+    VM_GT,
+    VM_LT,
+    VM_AND,
+    VM_OR,
+    VM_NOT,
+    VM_PUSH,
+    VM_POP,
+    VM_LABEL,
+    VM_GOTO,
+    VM_IF_GOTO,
+    VM_FUNCTION,
+    VM_CALL,
+    VM_RETURN
+} VMOpcode;
+
+// Memory segments of push and pop
+typedef enum VMSegment {
+    SEG_NONE = 0,
+    SEG_ARGUMENT,
+    SEG_LOCAL,
+    SEG_STATIC,
+    SEG_CONSTANT,
+    SEG_THIS,
+    SEG_THAT,
+    SEG_POINTER,
+    SEG_TEMP
+} VMSegment;
+
+/* Interned names of labels and functions
+ * Each name is stored once, and known by its id (its index in names).
+ * slots is an open addressing table of ids (-1 when empty) used to find the
+ * id of a name without comparing it to all the others.
+ */
+typedef struct VMSymbols {
+    char **names;
+    int size;
+    int capacity;
+    int *slots;
+    int slotCapacity;
+} VMSymbols;
+void VMS_init(VMSymbols *p_symbols);
+void VMS_clear(VMSymbols *p_symbols);
+// Returns the id of the length first chars of name, adding it if needed
+int VMS_intern(VMSymbols *p_symbols, const char *name, size_t length);
+const char *VMS_name(const VMSymbols *p_symbols, int id);
+
+// A parsed line
 typedef struct VMCommand {
-    char **command;
+    VMOpcode opcode;
+    // Segment of push and pop, SEG_NONE otherwise
+    VMSegment segment;
+    // Index of push and pop, number of locals of function, number of
+    // arguments of call
+    int index;
+    // Symbol id of the label or function name, -1 if the command has none
+    int symbol;
     // Current function name.
     char *functionName;
 } VMCommand;
 void VMC_init(VMCommand *p_vmc);
 void VMC_clear(VMCommand *p_vmc);
-void VMC_set_function_name(VMCommand *p_vmc, char *newFunctionName);
+void VMC_set_function_name(VMCommand *p_vmc, const char *newFunctionName);
 
 #endif  // _VMTTOOLS_H_
@@ -21,199 +21,371 @@ void LC_init(LabelCounter* p_lc) {
 
 void LC_reset_return_counter(LabelCounter* p_lc) { p_lc->nb_return = 0; }
 
-void write_to_file(FILE* filestream, const VMCommand* p_cmd,
-                   LabelCounter* p_labelCounter, const char* asm_stub,
-                   char* basename, char* staticName) {
-    char* asm_stub_copy = strdup(asm_stub);
+// Stub source of each VMStub
+static const char* const stub_sources[STUB_COUNT] = {
+    [STUB_ADD] = add_asm,
+    [STUB_SUB] = sub_asm,
+    [STUB_NEG] = neg_asm,
+    [STUB_EQ] = eq_asm,
+    [STUB_GT] = gt_asm,
+    [STUB_LT] = lt_asm,
+    [STUB_AND] = and_asm,
+    [STUB_OR] = or_asm,
+    [STUB_NOT] = not_asm,
+    [STUB_PUSH_CLASSIC] = push_classic_i_asm,
+    [STUB_PUSH_STATIC] = push_static_i_asm,
+    [STUB_PUSH_CONSTANT] = push_constant_i_asm,
+    [STUB_PUSH_POINTER] = push_pointer_b_asm,
+    [STUB_PUSH_TEMP] = push_temp_i_asm,
+    [STUB_POP_CLASSIC] = pop_classic_i_asm,
+    [STUB_POP_STATIC] = pop_static_i_asm,
+    [STUB_POP_POINTER] = pop_pointer_b_asm,
+    [STUB_POP_TEMP] = pop_temp_i_asm,
+    [STUB_LABEL] = label_asm,
+    [STUB_GOTO] = goto_asm,
+    [STUB_IF_GOTO] = if_goto_asm,
+    [STUB_FUNCTION] = function_asm,
+    [STUB_CALL] = call_asm,
+    [STUB_RETURN] = return_asm};
+
+// Stub source of the commands that jump to the routines of shared_asm
+static const char* const shared_sources[STUB_COUNT] = {
+    [STUB_EQ] = eq_shared_asm,
+    [STUB_GT] = gt_shared_asm,
+    [STUB_LT] = lt_shared_asm,
+    [STUB_CALL] = call_shared_asm,
+    [STUB_RETURN] = return_shared_asm};
+
+typedef struct VMKeywordSlot {
+    const char* keyword;
+    VMSlot slot;
+} VMKeywordSlot;
+
+static const VMKeywordSlot keyword_slots[] = {
+    {"BASENAME", SLOT_BASENAME},     {"STATICNAME", SLOT_STATICNAME},
+    {"CALLEENAME", SLOT_SYMBOL},     {"LABEL", SLOT_SYMBOL},
+    {"FUNCTIONNAME", SLOT_FUNCTIONNAME}, {"I", SLOT_INDEX},
+    {"J", SLOT_LABEL_ID},            {"RET_ID", SLOT_RET_ID},
+    {"CLASSIC", SLOT_CLASSIC},       {"K", SLOT_POINTER}};
+#define KEYWORD_SLOT_COUNT (sizeof(keyword_slots) / sizeof(keyword_slots[0]))
+
+// Adds a part to p_template, text parts being merged with the previous one
+static void VMT_push_part(VMTemplate* p_template, int* p_capacity,
+                          VMSlot slot, int offset, int length) {
+    if (slot == SLOT_TEXT && p_template->partCount > 0) {
+        VMTemplatePart* p_last = p_template->parts + p_template->partCount - 1;
+        if (p_last->slot == SLOT_TEXT) {
+            p_last->length += length;
+            return;
+        }
+    }
+    if (p_template->partCount == *p_capacity) {
+        *p_capacity *= 2;
+        VMTemplatePart* newParts = realloc(
+            p_template->parts, *p_capacity * sizeof(VMTemplatePart));
+        if (newParts == NULL) {
+            fprintf(stderr, "Could not grow a template\n");
+            exit(1);
+        }
+        p_template->parts = newParts;
+    }
+    VMTemplatePart* p_part = p_template->parts + p_template->partCount++;
+    p_part->slot = slot;
+    p_part->offset = offset;
+    p_part->length = length;
+}
+
+// Copies length chars of text at the end of the text of p_template
+static void VMT_push_text(VMTemplate* p_template, int* p_capacity,
+                          int* p_textLength, const char* text, int length) {
+    if (length == 0) {
+        return;
+    }
+    memcpy(p_template->text + *p_textLength, text, length);
+    VMT_push_part(p_template, p_capacity, SLOT_TEXT, *p_textLength, length);
+    *p_textLength += length;
+}
+
+// Returns the slot of the keyword of length chars at word, SLOT_TEXT if it
+// is not a keyword
+static VMSlot VMT_find_slot(const char* word, size_t length) {
+    for (size_t k = 0; k < KEYWORD_SLOT_COUNT; ++k) {
+        if (strncmp(keyword_slots[k].keyword, word, length) == 0 &&
+            keyword_slots[k].keyword[length] == '\0') {
+            return keyword_slots[k].slot;
+        }
+    }
+    return SLOT_TEXT;
+}
+
+// Splits stub into p_template : the words between the separators that are
+// keywords become slots, the rest of the lines is text
+static void VMT_compile(VMTemplate* p_template, const char* stub) {
     const char* sep = " .=@()$";
-    /* Keywords to change :
-     * BASENAME -> basename
-     * STATICNAME -> staticName
-     * CALLEENAME -> p_cmd->command[1] for call XX y commands
-     * FUNCTIONNAME -> current function name stored in p_cmd->functionName
-     * I -> asm_stub_number
-     * J -> Label Counter. nb_all
-     * RET_ID -> Label Counter . nb_return
-     * CLASSIC -> LCL or ARG or THIS or THAT or TEMP
-     * B -> THIS if asm_sub_number == 0; THAT if asm_stub_number == 1
-     */
-    // TODO : Use strtok bc it replaces
-    char* line = strtok(asm_stub_copy, "\r\n");
-    while (line != NULL) {
-        char asm_line_buffer[ASM_LINE_BUFFER_SIZE];
-        asm_line_buffer[0] = '\0';
-        // TODO : Do not use strtok because we won't replace
-        char* significant_word = line;
-        // Take out the '@' special case and the '(' one
-        if (strncmp(line, "@", 1) == 0) {
-            strcat(asm_line_buffer, "@");
-            line += 1;
-            significant_word += 1;
-        } else if (strncmp(line, "(", 1) == 0) {
-            strcat(asm_line_buffer, "(");
+    int capacity = 16;
+    int textLength = 0;
+    p_template->text = malloc(strlen(stub) + 2);
+    p_template->parts = malloc(capacity * sizeof(VMTemplatePart));
+    p_template->partCount = 0;
+    if (p_template->text == NULL || p_template->parts == NULL) {
+        fprintf(stderr, "Could not allocate a template\n");
+        exit(1);
+    }
+
+    const char* line = stub;
+    while (*line != '\0') {
+        size_t lineLength = strcspn(line, "\r\n");
+        if (lineLength == 0) {
             line += 1;
-            significant_word += 1;
+            continue;
+        }
+        const char* end = line + lineLength;
+        // Start of the text not added yet
+        const char* text = line;
+        const char* word = line;
+        // Take out the '@' special case and the '(' one
+        if (*word == '@' || *word == '(') {
+            word += 1;
         }
-        size_t s_word_length = strcspn(line, sep);
-        while (significant_word && *significant_word) {
-            if (strncmp(significant_word, "BASENAME", s_word_length) == 0) {
-                strcat(asm_line_buffer, basename);
-            } else if (strncmp(significant_word, "STATICNAME", s_word_length) ==
-                       0) {
-                strcat(asm_line_buffer, staticName);
-            } else if (strncmp(significant_word, "CALLEENAME", s_word_length) ==
-                       0) {
-                strcat(asm_line_buffer, p_cmd->command[1]);
-            } else if (strncmp(significant_word, "LABEL", s_word_length) == 0) {
-                strcat(asm_line_buffer, p_cmd->command[1]);
-            } else if (strncmp(significant_word, "FUNCTIONNAME",
-                               s_word_length) == 0) {
-                strcat(asm_line_buffer, p_cmd->functionName);
-            } else if (strncmp(significant_word, "I", s_word_length) == 0) {
-                strcat(asm_line_buffer, p_cmd->command[2]);
-            } else if (strncmp(significant_word, "J", s_word_length) == 0) {
-                char nb_all_string[15];
-                sprintf(nb_all_string, "%d", p_labelCounter->nb_all);
-                strcat(asm_line_buffer, nb_all_string);
-            } else if (strncmp(significant_word, "CLASSIC", s_word_length) ==
-                       0) {
-                if (strcmp(p_cmd->command[1], "local") == 0) {
-                    strcat(asm_line_buffer, "LCL");
-                } else if (strcmp(p_cmd->command[1], "argument") == 0) {
-                    strcat(asm_line_buffer, "ARG");
-                } else if (strcmp(p_cmd->command[1], "this") == 0) {
-                    strcat(asm_line_buffer, "THIS");
-                } else if (strcmp(p_cmd->command[1], "that") == 0) {
-                    strcat(asm_line_buffer, "THAT");
-                } else if (strcmp(p_cmd->command[1], "temp") == 0) {
-                    strcat(asm_line_buffer, "5");
+        while (word < end) {
+            size_t wordLength = strcspn(word, sep);
+            if (wordLength > (size_t)(end - word)) {
+                wordLength = end - word;
+            }
+            VMSlot slot = VMT_find_slot(word, wordLength);
+            if (wordLength > 0 && slot != SLOT_TEXT) {
+                VMT_push_text(p_template, &capacity, &textLength, text,
+                              word - text);
+                VMT_push_part(p_template, &capacity, slot, 0, 0);
+                text = word + wordLength;
+            }
+            word += wordLength;
+            word += strspn(word, sep);
+        }
+        VMT_push_text(p_template, &capacity, &textLength, text, end - text);
+        VMT_push_text(p_template, &capacity, &textLength, "\n", 1);
+        line = end;
+    }
+}
+
+void VMT_init(VMTemplates* p_templates, bool shared) {
+    for (int i = 0; i < STUB_COUNT; ++i) {
+        const char* source = stub_sources[i];
+        if (shared && shared_sources[i] != NULL) {
+            source = shared_sources[i];
+        }
+        VMT_compile(p_templates->stubs + i, source);
+    }
+}
+
+void VMT_clear(VMTemplates* p_templates) {
+    for (int i = 0; i < STUB_COUNT; ++i) {
+        free(p_templates->stubs[i].text);
+        free(p_templates->stubs[i].parts);
+        p_templates->stubs[i].text = NULL;
+        p_templates->stubs[i].parts = NULL;
+        p_templates->stubs[i].partCount = 0;
+    }
+}
+
+void VMO_init(VMOutput* p_output, FILE* stream) {
+    p_output->stream = stream;
+    p_output->length = 0;
+    p_output->failed = false;
+    p_output->buffer = malloc(VM_OUTPUT_BUFFER_SIZE);
+    if (p_output->buffer == NULL) {
+        fprintf(stderr, "Could not allocate the output buffer\n");
+        exit(1);
+    }
+}
+
+bool VMO_flush(VMOutput* p_output) {
+    bool written = fwrite(p_output->buffer, 1, p_output->length,
+                          p_output->stream) == p_output->length;
+    p_output->length = 0;
+    if (!written) {
+        p_output->failed = true;
+    }
+    return written;
+}
+
+void VMO_append(VMOutput* p_output, const char* text, size_t length) {
+    if (p_output->length + length > VM_OUTPUT_BUFFER_SIZE) {
+        VMO_flush(p_output);
+        if (length > VM_OUTPUT_BUFFER_SIZE) {
+            if (fwrite(text, 1, length, p_output->stream) != length) {
+                p_output->failed = true;
+            }
+            return;
+        }
+    }
+    memcpy(p_output->buffer + p_output->length, text, length);
+    p_output->length += length;
+}
+
+bool VMO_clear(VMOutput* p_output) {
+    VMO_flush(p_output);
+    // The stream may still hold the end of the translation
+    if (fflush(p_output->stream) != 0 || ferror(p_output->stream)) {
+        p_output->failed = true;
+    }
+    free(p_output->buffer);
+    p_output->buffer = NULL;
+    return !p_output->failed;
+}
+
+void VMO_append_int(VMOutput* p_output, int number) {
+    char digits[12];
+    int start = sizeof(digits);
+    do {
+        digits[--start] = '0' + number % 10;
+        number /= 10;
+    } while (number > 0);
+    VMO_append(p_output, digits + start, sizeof(digits) - start);
+}
+
+void VMO_append_string(VMOutput* p_output, const char* text) {
+    VMO_append(p_output, text, strlen(text));
+}
+
+void write_to_file(VMOutput* p_output, const VMCommand* p_cmd,
+                   const VMSymbols* p_symbols, LabelCounter* p_labelCounter,
+                   const VMTemplates* p_templates, VMStub stub,
+                   const char* basename, const char* staticName) {
+    const VMTemplate* p_template = p_templates->stubs + stub;
+    for (int i = 0; i < p_template->partCount; ++i) {
+        const VMTemplatePart* p_part = p_template->parts + i;
+        switch (p_part->slot) {
+            case SLOT_TEXT:
+                VMO_append(p_output, p_template->text + p_part->offset,
+                           p_part->length);
+                break;
+            case SLOT_BASENAME:
+                VMO_append_string(p_output, basename);
+                break;
+            case SLOT_STATICNAME:
+                VMO_append_string(p_output, staticName);
+                break;
+            case SLOT_SYMBOL:
+                VMO_append_string(p_output,
+                                  VMS_name(p_symbols, p_cmd->symbol));
+                break;
+            case SLOT_FUNCTIONNAME:
+                VMO_append_string(p_output, p_cmd->functionName);
+                break;
+            case SLOT_INDEX:
+                VMO_append_int(p_output, p_cmd->index);
+                break;
+            case SLOT_LABEL_ID:
+                VMO_append_int(p_output, p_labelCounter->nb_all);
+                break;
+            case SLOT_RET_ID:
+                VMO_append_int(p_output, p_labelCounter->nb_return);
+                break;
+            case SLOT_CLASSIC:
+                if (p_cmd->segment == SEG_LOCAL) {
+                    VMO_append(p_output, "LCL", 3);
+                } else if (p_cmd->segment == SEG_ARGUMENT) {
+                    VMO_append(p_output, "ARG", 3);
+                } else if (p_cmd->segment == SEG_THIS) {
+                    VMO_append(p_output, "THIS", 4);
+                } else if (p_cmd->segment == SEG_THAT) {
+                    VMO_append(p_output, "THAT", 4);
+                } else if (p_cmd->segment == SEG_TEMP) {
+                    VMO_append(p_output, "5", 1);
                 }
-            } else if (strncmp(significant_word, "K", s_word_length) == 0) {
-                if (atoi(p_cmd->command[2]) == 0) {
-                    strcat(asm_line_buffer, "THIS");
-                } else if (atoi(p_cmd->command[2]) == 1) {
-                    strcat(asm_line_buffer, "THAT");
+                break;
+            case SLOT_POINTER:
+                if (p_cmd->index == 0) {
+                    VMO_append(p_output, "THIS", 4);
+                } else if (p_cmd->index == 1) {
+                    VMO_append(p_output, "THAT", 4);
                 } else {
                     fprintf(stderr, "Number not recognised in pointer command");
                     exit(1);
                 }
-            } else if (strncmp(significant_word, "RET_ID", s_word_length) ==
-                       0) {
-                char nb_ret_string[15];
-                sprintf(nb_ret_string, "%d", p_labelCounter->nb_return);
-                strcat(asm_line_buffer, nb_ret_string);
-            } else {
-                strncat(asm_line_buffer, significant_word, s_word_length);
-                /* strcat(asm_line_buffer, " "); */
-            }
-            // Advance the significant_word pointer
-            significant_word += s_word_length;
-            // Write all the separator characters and then skip them
-            size_t number_of_sep_to_write = strspn(significant_word, sep);
-            strncat(asm_line_buffer, significant_word, number_of_sep_to_write);
-            significant_word += number_of_sep_to_write;
-            // Find the next significant word to advance the loop
-            s_word_length = strcspn(significant_word, sep);
+                break;
         }
-        fputs(asm_line_buffer, filestream);
-        fputs("\n", filestream);
-        line = strtok(NULL, "\n");
     }
 
-    if (asm_stub == return_asm) {
+    // The return labels are numbered per function, as a function can
+    // return several times
+    if (stub == STUB_FUNCTION) {
         LC_reset_return_counter(p_labelCounter);
-    } else if (asm_stub == call_asm) {
+    } else if (stub == STUB_CALL) {
         p_labelCounter->nb_return++;
     }
     p_labelCounter->nb_all++;
-    free(asm_stub_copy);
 }
 
-const char* choose_asm_dict_file(VMCommand* p_cmd, int command_len) {
-    if (command_len == 1) {
-        if (strcmp(p_cmd->command[0], "add") == 0) {
-            return add_asm;
-        } else if (strcmp(p_cmd->command[0], "and") == 0) {
-            return and_asm;
-        } else if (strcmp(p_cmd->command[0], "eq") == 0) {
-            return eq_asm;
-        } else if (strcmp(p_cmd->command[0], "gt") == 0) {
-            return gt_asm;
-        } else if (strcmp(p_cmd->command[0], "lt") == 0) {
-            return lt_asm;
-        } else if (strcmp(p_cmd->command[0], "neg") == 0) {
-            return neg_asm;
-        } else if (strcmp(p_cmd->command[0], "not") == 0) {
-            return not_asm;
-        } else if (strcmp(p_cmd->command[0], "or") == 0) {
-            return or_asm;
-        } else if (strcmp(p_cmd->command[0], "sub") == 0) {
-            return sub_asm;
-        } else if (strcmp(p_cmd->command[0], "return") == 0) {
-            return return_asm;
-        }
-
-    } else if (command_len == 3) {
-        // Big old string switch
-        if (strcmp(p_cmd->command[0], "push") == 0 &&
-            strcmp(p_cmd->command[1], "pointer") == 0) {
-            return push_pointer_b_asm;
-        } else if (strcmp(p_cmd->command[0], "pop") == 0 &&
-                   strcmp(p_cmd->command[1], "pointer") == 0) {
-            return pop_pointer_b_asm;
-        } else if (strcmp(p_cmd->command[0], "push") == 0 &&
-                   strcmp(p_cmd->command[1], "constant") == 0) {
-            return push_constant_i_asm;
-        } else if (strcmp(p_cmd->command[0], "pop") == 0 &&
-                   strcmp(p_cmd->command[1], "static") == 0) {
-            return pop_static_i_asm;
-        } else if (strcmp(p_cmd->command[0], "push") == 0 &&
-                   strcmp(p_cmd->command[1], "static") == 0) {
-            return push_static_i_asm;
-        } else if (strcmp(p_cmd->command[0], "pop") == 0 &&
-                   strcmp(p_cmd->command[1], "local") == 0) {
-            return pop_classic_i_asm;
-        } else if (strcmp(p_cmd->command[0], "pop") == 0 &&
-                   strcmp(p_cmd->command[1], "argument") == 0) {
-            return pop_classic_i_asm;
-        } else if (strcmp(p_cmd->command[0], "pop") == 0 &&
-                   strcmp(p_cmd->command[1], "this") == 0) {
-            return pop_classic_i_asm;
-        } else if (strcmp(p_cmd->command[0], "pop") == 0 &&
-                   strcmp(p_cmd->command[1], "that") == 0) {
-            return pop_classic_i_asm;
-        } else if (strcmp(p_cmd->command[0], "pop") == 0 &&
-                   strcmp(p_cmd->command[1], "temp") == 0) {
-            return pop_temp_i_asm;
-        } else if (strcmp(p_cmd->command[0], "push") == 0 &&
-                   strcmp(p_cmd->command[1], "local") == 0) {
-            return push_classic_i_asm;
-        } else if (strcmp(p_cmd->command[0], "push") == 0 &&
-                   strcmp(p_cmd->command[1], "argument") == 0) {
-            return push_classic_i_asm;
-        } else if (strcmp(p_cmd->command[0], "push") == 0 &&
-                   strcmp(p_cmd->command[1], "this") == 0) {
-            return push_classic_i_asm;
-        } else if (strcmp(p_cmd->command[0], "push") == 0 &&
-                   strcmp(p_cmd->command[1], "that") == 0) {
-            return push_classic_i_asm;
-        } else if (strcmp(p_cmd->command[0], "push") == 0 &&
-                   strcmp(p_cmd->command[1], "temp") == 0) {
-            return push_temp_i_asm;
-        } else if (strcmp(p_cmd->command[0], "function") == 0) {
-            VMC_set_function_name(p_cmd, p_cmd->command[1]);
-            return function_asm;
-        } else if (strcmp(p_cmd->command[0], "call") == 0) {
-            return call_asm;
-        }
-    } else if (command_len == 2) {
-        if (strcmp(p_cmd->command[0], "label") == 0) {
-            return label_asm;
-        } else if (strcmp(p_cmd->command[0], "goto") == 0) {
-            return goto_asm;
-        } else if (strcmp(p_cmd->command[0], "if-goto") == 0) {
-            return if_goto_asm;
-        }
+VMStub choose_asm_dict_file(const VMCommand* p_cmd) {
+    switch (p_cmd->opcode) {
+        case VM_ADD:
+            return STUB_ADD;
+        case VM_SUB:
+            return STUB_SUB;
+        case VM_NEG:
+            return STUB_NEG;
+        case VM_EQ:
+            return STUB_EQ;
+        case VM_GT:
+            return STUB_GT;
+        case VM_LT:
+            return STUB_LT;
+        case VM_AND:
+            return STUB_AND;
+        case VM_OR:
+            return STUB_OR;
+        case VM_NOT:
+            return STUB_NOT;
+        case VM_PUSH:
+            switch (p_cmd->segment) {
+                case SEG_ARGUMENT:
+                case SEG_LOCAL:
+                case SEG_THIS:
+                case SEG_THAT:
+                    return STUB_PUSH_CLASSIC;
+                case SEG_STATIC:
+                    return STUB_PUSH_STATIC;
+                case SEG_CONSTANT:
+                    return STUB_PUSH_CONSTANT;
+                case SEG_POINTER:
+                    return STUB_PUSH_POINTER;
+                case SEG_TEMP:
+                    return STUB_PUSH_TEMP;
+                default:
+                    return STUB_NONE;
+            }
+        case VM_POP:
+            switch (p_cmd->segment) {
+                case SEG_ARGUMENT:
+                case SEG_LOCAL:
+                case SEG_THIS:
+                case SEG_THAT:
+                    return STUB_POP_CLASSIC;
+                case SEG_STATIC:
+                    return STUB_POP_STATIC;
+                case SEG_POINTER:
+                    return STUB_POP_POINTER;
+                case SEG_TEMP:
+                    return STUB_POP_TEMP;
+                default:
+                    // No pop constant
+                    return STUB_NONE;
+            }
+        case VM_LABEL:
+            return STUB_LABEL;
+        case VM_GOTO:
+            return STUB_GOTO;
+        case VM_IF_GOTO:
+            return STUB_IF_GOTO;
+        case VM_FUNCTION:
+            return STUB_FUNCTION;
+        case VM_CALL:
+            return STUB_CALL;
+        case VM_RETURN:
+            return STUB_RETURN;
+        default:
+            return STUB_NONE;
     }
-    return NULL;
 }
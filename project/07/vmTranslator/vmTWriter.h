@@ -17,7 +17,7 @@
 #ifndef __STDC_WANT_LIB_EXT2__
 #define __STDC_WANT_LIB_EXT2__ 1
 #endif  // __STDC_WANT_LIB_EXT2__
-#define ASM_LINE_BUFFER_SIZE 33
+#define VM_OUTPUT_BUFFER_SIZE 65536
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -34,33 +34,128 @@ typedef struct LabelCounter {
 void LC_reset_return_counter(LabelCounter* p_lc);
 void LC_init(LabelCounter* p_lc);
 
-/* Choose the correct asm file for the translation
- * this function is neither responsible for malloc nor freeing memory
- * for command[i] arrays.
- * Giving the number of words in the command helps the choosing
- * The returned string should NOT be modified, and is ine of the strings in
- * vmTDictFiles.h
+// Stubs of vmTDictFiles, one per kind of command
+typedef enum VMStub {
+    STUB_NONE = -1,
+    STUB_ADD,
+    STUB_SUB,
+    STUB_NEG,
+    STUB_EQ,
+    STUB_GT,
+    STUB_LT,
+    STUB_AND,
+    STUB_OR,
+    STUB_NOT,
+    STUB_PUSH_CLASSIC,
+    STUB_PUSH_STATIC,
+    STUB_PUSH_CONSTANT,
+    STUB_PUSH_POINTER,
+    STUB_PUSH_TEMP,
+    STUB_POP_CLASSIC,
+    STUB_POP_STATIC,
+    STUB_POP_POINTER,
+    STUB_POP_TEMP,
+    STUB_LABEL,
+    STUB_GOTO,
+    STUB_IF_GOTO,
+    STUB_FUNCTION,
+    STUB_CALL,
+    STUB_RETURN,
+    STUB_COUNT
+} VMStub;
+
+/* Keywords of the stubs, replaced when a command is written :
+ * BASENAME -> basename
+ * STATICNAME -> staticName
+ * CALLEENAME, LABEL -> name of p_cmd->symbol
+ * FUNCTIONNAME -> current function name stored in p_cmd->functionName
+ * I -> index of the command
+ * J -> p_labelCounter->nb_all
+ * RET_ID -> p_labelCounter->nb_return
+ * CLASSIC -> LCL or ARG or THIS or THAT, or 5 for temp
+ * K -> THIS if the index is 0, THAT if it is 1
+ */
+typedef enum VMSlot {
+    SLOT_TEXT,
+    SLOT_BASENAME,
+    SLOT_STATICNAME,
+    SLOT_SYMBOL,
+    SLOT_FUNCTIONNAME,
+    SLOT_INDEX,
+    SLOT_LABEL_ID,
+    SLOT_RET_ID,
+    SLOT_CLASSIC,
+    SLOT_POINTER
+} VMSlot;
+
+// Part of a template : length chars of its text from offset, or a keyword
+typedef struct VMTemplatePart {
+    VMSlot slot;
+    int offset;
+    int length;
+} VMTemplatePart;
+
+/* Stub split once into its text and keyword slots, so that writing a
+ * command is a sequence of copies
+ * The text holds the lines of the stub without the keywords, the empty
+ * lines and the \r, each line ending with \n.
+ */
+typedef struct VMTemplate {
+    char* text;
+    VMTemplatePart* parts;
+    int partCount;
+} VMTemplate;
+
+typedef struct VMTemplates {
+    VMTemplate stubs[STUB_COUNT];
+} VMTemplates;
+
+/* Splits every stub of vmTDictFiles
+ * shared : call, return, eq, gt and lt jump to the routines of shared_asm
+ * instead of being written in full
+ */
+void VMT_init(VMTemplates* p_templates, bool shared);
+void VMT_clear(VMTemplates* p_templates);
+
+// Output of the translation, written to stream by blocks
+typedef struct VMOutput {
+    FILE* stream;
+    char* buffer;
+    size_t length;
+    // Set by the first write error, so that it is reported at the end
+    bool failed;
+} VMOutput;
+
+void VMO_init(VMOutput* p_output, FILE* stream);
+void VMO_append(VMOutput* p_output, const char* text, size_t length);
+void VMO_append_string(VMOutput* p_output, const char* text);
+// Appends the decimal text of a non negative number
+void VMO_append_int(VMOutput* p_output, int number);
+// Writes the buffer to the stream, returns false on a write error
+bool VMO_flush(VMOutput* p_output);
+// Flushes, and frees the buffer
+// Returns false if any write to the stream failed
+bool VMO_clear(VMOutput* p_output);
+
+/* Choose the correct stub for the translation, from the opcode and
+ * segment of the parsed command. Returns STUB_NONE if there is no stub for
+ * it.
  */
-const char* choose_asm_dict_file(VMCommand* p_cmd, int command_len);
+VMStub choose_asm_dict_file(const VMCommand* p_cmd);
 
 /* Main writer function :
- * filestream : output filestream
- * command : originally parsed command, used to get command[2]
+ * p_output : output of the translation
+ * command : parsed command, used to get its segment, index and symbol
+ * p_symbols : interned names of the labels and functions
  * p_labelCounter : pointer to LabelCounter struct to make unique labels
- * asm_stub : COPY (caller responsiblity) of the XXX_asm string in vmTDictFiles
- * asm_stub_number : int version of command[2] when applicable, negative
- * otherwise
+ * stub : stub of the command, found in p_templates
  * basename : basename of the vm file to produce unique static labels
  *
- * I = replaced by command[2]
- * J = replaced by p_labelCounter->nb_all
- * K = replaced by THIS or THAT if command[2] is 0 or 1
- * L = replaced by p_labelCounter->nb_return
- *
- * Also resets the nb_return counter if command[0] is return
+ * Also resets the nb_return counter if the command is function
  */
-void write_to_file(FILE* filestream, const VMCommand* p_cmd,
-                   LabelCounter* p_labelCounter, const char* asm_stub,
-                   char* basename, char* staticName);
+void write_to_file(VMOutput* p_output, const VMCommand* p_cmd,
+                   const VMSymbols* p_symbols, LabelCounter* p_labelCounter,
+                   const VMTemplates* p_templates, VMStub stub,
+                   const char* basename, const char* staticName);
 
 #endif  // _VMTWRITER_H_